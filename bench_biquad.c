@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------------
+// name: bench_biquad.c
+// desc: cost of the per-slice biquad filters
+//
+//   checks biquad_process() against a plain double precision cascade for
+//   1 to BIQUAD_SECTIONS sections fed in uneven blocks, then times a
+//   highpass and a lowpass on every slice and prints the cost as a
+//   share of one core.
+//
+//   usage: bench_biquad [number of slices] [iterations]
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "engine.h"
+#include "biquad.h"
+
+
+#define CHECK_FRAMES            20000
+#define DEFAULT_ITERATIONS      2000
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: now()
+// desc: monotonic time in seconds
+//-----------------------------------------------------------------------------
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: reference()
+// desc: the same cascade one sample at a time in double precision
+//-----------------------------------------------------------------------------
+static void reference( const biquadCascade * bq, double * x, long frames )
+{
+    int s, c;
+    long i;
+
+    for( s = 0; s < bq->count; s++ )
+    {
+        const biquadSection * q = &bq->section[s];
+
+        for( c = 0; c < 2; c++ )
+        {
+            double z1 = 0, z2 = 0, in, y;
+
+            for( i = 0; i < frames; i++ )
+            {
+                in = x[2*i+c];
+                y = q->b0 * in + z1;
+                z1 = q->b1 * in - q->a1 * y + z2;
+                z2 = q->b2 * in - q->a2 * y;
+                x[2*i+c] = y;
+            }
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: ...
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    static float input[CHECK_FRAMES * STEREO];
+    static float x[CHECK_FRAMES * STEREO];
+    static double ref[CHECK_FRAMES * STEREO];
+    static float block[MAX_SLICES][BUFFER_SIZE * STEREO];
+    static biquadCascade eq[MAX_SLICES];
+    int numSlices = argc > 1 ? atoi( argv[1] ) : DEFAULT_SLICES;
+    int iterations = argc > 2 ? atoi( argv[2] ) : DEFAULT_ITERATIONS;
+    int sections, s, it;
+    long i, done, n;
+    double start, t, period;
+
+    if( numSlices < 1 || numSlices > MAX_SLICES )
+    {
+        printf( "number of slices must be between 1 and %d\n", MAX_SLICES );
+        return 1;
+    }
+
+    for( i = 0; i < CHECK_FRAMES * STEREO; i++ )
+        input[i] = (float)rand() / RAND_MAX - 0.5f;
+
+    for( sections = 1; sections <= BIQUAD_SECTIONS; sections++ )
+    {
+        biquadCascade bq;
+        double err = 0, peak = 1e-20;
+
+        biquad_init( &bq, SAMPLING_RATE );
+        for( s = 0; s < sections; s++ )
+            biquad_set( &bq, s, (biquadType)(BIQUAD_LOWPASS + (s + sections) % 6),
+                        200.f + 1500.f * s, 0.9f, 6.f );
+
+        for( i = 0; i < CHECK_FRAMES * STEREO; i++ )
+        {
+            x[i] = input[i];
+            ref[i] = input[i];
+        }
+        reference( &bq, ref, CHECK_FRAMES );
+        for( done = 0; done < CHECK_FRAMES; done += n )
+        {
+            n = 1 + rand() % 700;
+            if( n > CHECK_FRAMES - done )
+                n = CHECK_FRAMES - done;
+            biquad_process( &bq, x + done * STEREO, n );
+        }
+
+        for( i = 0; i < CHECK_FRAMES * STEREO; i++ )
+        {
+            if( fabs( x[i] - ref[i] ) > err )
+                err = fabs( x[i] - ref[i] );
+            if( fabs( ref[i] ) > peak )
+                peak = fabs( ref[i] );
+        }
+        if( err / peak > 1e-4 )
+        {
+            printf( "%d sections: mismatch %g\n", sections, err / peak );
+            return 1;
+        }
+    }
+
+    for( s = 0; s < numSlices; s++ )
+    {
+        biquad_init( &eq[s], SAMPLING_RATE );
+        biquad_set( &eq[s], 0, BIQUAD_HIGHPASS, 120.f, BIQUAD_Q, 0 );
+        biquad_set( &eq[s], 1, BIQUAD_LOWPASS, 6000.f, BIQUAD_Q, 0 );
+        for( i = 0; i < BUFFER_SIZE * STEREO; i++ )
+            block[s][i] = input[i];
+    }
+
+    start = now();
+    for( it = 0; it < iterations; it++ )
+        for( s = 0; s < numSlices; s++ )
+            biquad_process( &eq[s], block[s], BUFFER_SIZE );
+    t = (now() - start) / iterations;
+    period = (double)BUFFER_SIZE / SAMPLING_RATE;
+
+    printf( "%d slices, highpass + lowpass, %d frames: %.1f us per block, %.3f%% of a core\n",
+            numSlices, BUFFER_SIZE, t * 1e6, 100 * t / period );
+
+    return 0;
+}
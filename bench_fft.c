@@ -0,0 +1,243 @@
+//-----------------------------------------------------------------------------
+// name: bench_fft.c
+// desc: throughput benchmark for the real fft, rfft() against plan_rfft()
+//
+//   for every window length from 64 to 8192 runs a forward and an inverse
+//   transform (one filter round trip) with each butterfly kernel the cpu
+//   supports and prints the cost in ns per pair and the speedup over
+//   rfft().  every kernel is checked against cfft() and rfft() first.
+//
+//   then times BATCH frames through plan_rfft_batch() against BATCH
+//   separate plan_rfft() calls, reported as the number of single
+//   transforms the batch costs.
+//
+//   usage: bench_fft [iterations]
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "fft.h"
+
+
+#define MIN_WINDOW              64
+#define MAX_WINDOW              8192
+#define DEFAULT_ITERATIONS      20000
+#define BATCH                   8//frames per batched call, 4 slices x stereo
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: now()
+// desc: monotonic time in seconds
+//-----------------------------------------------------------------------------
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: max_error()
+// desc: largest difference relative to the largest reference value
+//-----------------------------------------------------------------------------
+static float max_error( const float * a, const float * ref, long n )
+{
+    float err = 0, peak = 1e-20f;
+    long i;
+
+    for( i = 0; i < n; i++ )
+    {
+        if( fabsf( a[i] - ref[i] ) > err )
+            err = fabsf( a[i] - ref[i] );
+        if( fabsf( ref[i] ) > peak )
+            peak = fabsf( ref[i] );
+    }
+
+    return err / peak;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: ...
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    static float input[MAX_WINDOW];
+    static float x[MAX_WINDOW];
+    static float ref[MAX_WINDOW];
+    static float batch[MAX_WINDOW * BATCH];
+    const fft_kernel * kernels;
+    int iterations = argc > 1 ? atoi( argv[1] ) : DEFAULT_ITERATIONS;
+    int numKernels, k, it;
+    long size, i;
+
+    for( i = 0; i < MAX_WINDOW; i++ )
+        input[i] = (float)rand() / RAND_MAX - 0.5f;
+
+    kernels = fft_kernels( &numKernels );
+
+    printf( "ns per forward + inverse pair, speedup over rfft\n" );
+    printf( "%-8s%10s", "window", "rfft" );
+    for( k = 0; k < numKernels; k++ )
+        printf( "%18s", kernels[k].name );
+    printf( "\n" );
+
+    for( size = MIN_WINDOW; size <= MAX_WINDOW; size *= 2 )
+    {
+        fft_plan * plan = fft_plan_create( size/2 );
+        int reps = (int)((long)iterations * MIN_WINDOW / size) + 1;
+        double start, tRfft;
+
+        if( plan == NULL )
+        {
+            printf( "could not make a plan for %ld\n", size );
+            return 1;
+        }
+
+        start = now();
+        for( it = 0; it < reps; it++ )
+        {
+            rfft( x, size/2, FFT_FORWARD );
+            rfft( x, size/2, FFT_INVERSE );
+        }
+        tRfft = (now() - start) * 1e9 / reps;
+        printf( "%-8ld%10.0f", size, tRfft );
+
+        for( k = 0; k < numKernels; k++ )
+        {
+            double t;
+
+            plan->kernel = &kernels[k];
+
+            // complex, real forward and real round trip must match the
+            // unplanned transforms
+            memcpy( ref, input, size * sizeof(float) );
+            cfft( ref, size/2, FFT_FORWARD );
+            memcpy( x, input, size * sizeof(float) );
+            plan_cfft( plan, x, FFT_FORWARD );
+            if( max_error( x, ref, size ) > 1e-4f )
+            {
+                printf( "\n%s %ld: cfft mismatch %g\n", kernels[k].name, size, max_error( x, ref, size ) );
+                return 1;
+            }
+            memcpy( ref, input, size * sizeof(float) );
+            rfft( ref, size/2, FFT_FORWARD );
+            memcpy( x, input, size * sizeof(float) );
+            plan_rfft( plan, x, FFT_FORWARD );
+            if( max_error( x, ref, size ) > 1e-4f )
+            {
+                printf( "\n%s %ld: rfft mismatch %g\n", kernels[k].name, size, max_error( x, ref, size ) );
+                return 1;
+            }
+            plan_rfft( plan, x, FFT_INVERSE );
+            if( max_error( x, input, size ) > 1e-4f )
+            {
+                printf( "\n%s %ld: round trip mismatch %g\n", kernels[k].name, size, max_error( x, input, size ) );
+                return 1;
+            }
+
+            start = now();
+            for( it = 0; it < reps; it++ )
+            {
+                plan_rfft( plan, x, FFT_FORWARD );
+                plan_rfft( plan, x, FFT_INVERSE );
+            }
+            t = (now() - start) * 1e9 / reps;
+            printf( "%10.0f (%4.1fx)", t, tRfft / t );
+        }
+        printf( "\n" );
+        fft_plan_free( plan );
+    }
+
+    printf( "\nns per %d forward + inverse pairs, batched and as single frames\n", BATCH );
+    printf( "%-8s", "window" );
+    for( k = 0; k < numKernels; k++ )
+        printf( "%30s", kernels[k].name );
+    printf( "\n" );
+
+    for( size = MIN_WINDOW; size <= MAX_WINDOW; size *= 2 )
+    {
+        fft_plan * plan = fft_plan_create( size/2 );
+        int reps = (int)((long)iterations * MIN_WINDOW / (size * BATCH)) + 1;
+        int f;
+
+        if( plan == NULL )
+        {
+            printf( "could not make a plan for %ld\n", size );
+            return 1;
+        }
+        printf( "%-8ld", size );
+
+        for( k = 0; k < numKernels; k++ )
+        {
+            double start, tSingle, tBatch;
+
+            plan->kernel = &kernels[k];
+
+            // frame f is the input rotated by f samples
+            for( f = 0; f < BATCH; f++ )
+                for( i = 0; i < size; i++ )
+                    batch[i*BATCH + f] = input[(i + f) % size];
+            plan_rfft_batch( plan, batch, BATCH, FFT_FORWARD );
+            for( f = 0; f < BATCH; f++ )
+            {
+                for( i = 0; i < size; i++ )
+                    ref[i] = input[(i + f) % size];
+                plan_rfft( plan, ref, FFT_FORWARD );
+                for( i = 0; i < size; i++ )
+                    x[i] = batch[i*BATCH + f];
+                if( max_error( x, ref, size ) > 1e-5f )
+                {
+                    printf( "\n%s %ld: batch frame %d mismatch %g\n", kernels[k].name, size, f, max_error( x, ref, size ) );
+                    return 1;
+                }
+            }
+            plan_rfft_batch( plan, batch, BATCH, FFT_INVERSE );
+            for( i = 0; i < size; i++ )
+                x[i] = batch[i*BATCH + 3];
+            for( i = 0; i < size; i++ )
+                ref[i] = input[(i + 3) % size];
+            if( max_error( x, ref, size ) > 1e-4f )
+            {
+                printf( "\n%s %ld: batch round trip mismatch %g\n", kernels[k].name, size, max_error( x, ref, size ) );
+                return 1;
+            }
+
+            start = now();
+            for( it = 0; it < reps; it++ )
+            {
+                for( f = 0; f < BATCH; f++ )
+                {
+                    plan_rfft( plan, x, FFT_FORWARD );
+                    plan_rfft( plan, x, FFT_INVERSE );
+                }
+            }
+            tSingle = (now() - start) * 1e9 / reps;
+
+            start = now();
+            for( it = 0; it < reps; it++ )
+            {
+                plan_rfft_batch( plan, batch, BATCH, FFT_FORWARD );
+                plan_rfft_batch( plan, batch, BATCH, FFT_INVERSE );
+            }
+            tBatch = (now() - start) * 1e9 / reps;
+
+            printf( "%10.0f /%9.0f (= %3.1f)", tBatch, tSingle, tBatch / (tSingle / BATCH) );
+        }
+        printf( "\n" );
+        fft_plan_free( plan );
+    }
+
+    return 0;
+}
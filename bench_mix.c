@@ -0,0 +1,99 @@
+//-----------------------------------------------------------------------------
+// name: bench_mix.c
+// desc: microbenchmark for the slice mixing kernels
+//
+//   mixes BUFFER_SIZE stereo frames from 4 up to 64 slices with every
+//   kernel the cpu supports and prints the cost in ns per output frame.
+//
+//   usage: bench_mix [iterations]
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "engine.h"
+#include "mixer.h"
+
+
+#define DEFAULT_ITERATIONS      2000
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: now()
+// desc: monotonic time in seconds
+//-----------------------------------------------------------------------------
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: ...
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    static float buffers[MAX_SLICES][BUFFER_SIZE * STEREO];
+    static float out[BUFFER_SIZE * STEREO];
+    static float ref[BUFFER_SIZE * STEREO];
+    const float * src[MAX_SLICES];
+    float gain[MAX_SLICES];
+    const mix_kernel * kernels;
+    int iterations = argc > 1 ? atoi( argv[1] ) : DEFAULT_ITERATIONS;
+    int numKernels, count, k, s, it;
+    long i;
+
+    for( s = 0; s < MAX_SLICES; s++ )
+    {
+        for( i = 0; i < BUFFER_SIZE * STEREO; i++ )
+            buffers[s][i] = (float)rand() / RAND_MAX - 0.5f;
+        src[s] = buffers[s];
+        gain[s] = 0.8f;
+    }
+
+    kernels = mix_kernels( &numKernels );
+
+    printf( "ns/frame, %d frames x %d iterations\n", BUFFER_SIZE, iterations );
+    printf( "%-8s", "slices" );
+    for( k = 0; k < numKernels; k++ )
+        printf( "%10s", kernels[k].name );
+    printf( "\n" );
+
+    for( count = 4; count <= MAX_SLICES; count *= 2 )
+    {
+        printf( "%-8d", count );
+        for( k = 0; k < numKernels; k++ )
+        {
+            double start;
+
+            // check against the scalar kernel (always last), also warms the caches
+            kernels[numKernels - 1].func( ref, src, gain, count, BUFFER_SIZE * STEREO );
+            kernels[k].func( out, src, gain, count, BUFFER_SIZE * STEREO );
+            for( i = 0; i < BUFFER_SIZE * STEREO; i++ )
+            {
+                if( fabsf( out[i] - ref[i] ) > 1e-4f )
+                {
+                    printf( "\n%s: mismatch at sample %ld\n", kernels[k].name, i );
+                    return 1;
+                }
+            }
+
+            start = now();
+            for( it = 0; it < iterations; it++ )
+                kernels[k].func( out, src, gain, count, BUFFER_SIZE * STEREO );
+
+            printf( "%10.2f", (now() - start) * 1e9 / ((double)iterations * BUFFER_SIZE) );
+        }
+        printf( "\n" );
+    }
+
+    return 0;
+}
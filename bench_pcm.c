@@ -0,0 +1,139 @@
+//-----------------------------------------------------------------------------
+// name: bench_pcm.c
+// desc: microbenchmark for the packed sample read kernels
+//
+//   checks every kernel the cpu supports against the scalar one, for runs
+//   of every length up to a few vectors and from every starting frame a
+//   vector step can land on, then converts BUFFER_SIZE stereo frames of
+//   16 and 24-bit audio with each and prints the cost in ns per frame.
+//   the float row is the plain interleave a float store does instead.
+//
+//   usage: bench_pcm [iterations]
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "engine.h"
+#include "pcm.h"
+
+
+#define DEFAULT_ITERATIONS      20000
+#define CHECK_FRAMES            40//longest run checked, past a few vector steps
+#define CHECK_OFFSETS           8
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: now()
+// desc: monotonic time in seconds
+//-----------------------------------------------------------------------------
+static double now()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: check()
+// desc: the packed formats convert exactly, so the kernels must agree bit
+//       for bit.  0 if they do
+//-----------------------------------------------------------------------------
+static int check( const pcm_kernel * kernel, const pcm_kernel * scalar, int bytes,
+                  const unsigned char * left, const unsigned char * right )
+{
+    float out[2 * CHECK_FRAMES], ref[2 * CHECK_FRAMES];
+    long frames;
+    int offset;
+
+    for( offset = 0; offset < CHECK_OFFSETS; offset++ )
+    {
+        for( frames = 0; frames <= CHECK_FRAMES; frames++ )
+        {
+            const unsigned char * l = left + offset * bytes, * r = right + offset * bytes;
+
+            if( bytes == 2 )
+            {
+                scalar->int16( ref, l, r, frames );
+                kernel->int16( out, l, r, frames );
+            }
+            else
+            {
+                scalar->int24( ref, l, r, frames );
+                kernel->int24( out, l, r, frames );
+            }
+            if( memcmp( out, ref, 2 * frames * sizeof(float) ) != 0 )
+            {
+                printf( "%s: %d-bit mismatch, %ld frames from %d\n",
+                        kernel->name, bytes * 8, frames, offset );
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: ...
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    static unsigned char left[(BUFFER_SIZE + CHECK_OFFSETS) * 4];
+    static unsigned char right[(BUFFER_SIZE + CHECK_OFFSETS) * 4];
+    static float out[BUFFER_SIZE * STEREO];
+    const pcm_kernel * kernels;
+    int iterations = argc > 1 ? atoi( argv[1] ) : DEFAULT_ITERATIONS;
+    int numKernels, k, it;
+    double start;
+    size_t i;
+
+    for( i = 0; i < sizeof(left); i++ )
+    {
+        left[i] = (unsigned char)rand();
+        right[i] = (unsigned char)rand();
+    }
+
+    kernels = pcm_kernels( &numKernels );
+    for( k = 0; k < numKernels - 1; k++ )
+    {
+        // the scalar kernel is always last
+        if( check( &kernels[k], &kernels[numKernels - 1], 2, left, right ) != 0 ||
+            check( &kernels[k], &kernels[numKernels - 1], 3, left, right ) != 0 )
+            return 1;
+    }
+
+    printf( "ns/frame, %d frames x %d iterations\n", BUFFER_SIZE, iterations );
+    printf( "%-8s%10s%10s\n", "kernel", "16-bit", "24-bit" );
+    for( k = 0; k < numKernels; k++ )
+    {
+        printf( "%-8s", kernels[k].name );
+
+        start = now();
+        for( it = 0; it < iterations; it++ )
+            kernels[k].int16( out, left, right, BUFFER_SIZE );
+        printf( "%10.3f", (now() - start) * 1e9 / ((double)iterations * BUFFER_SIZE) );
+
+        start = now();
+        for( it = 0; it < iterations; it++ )
+            kernels[k].int24( out, left, right, BUFFER_SIZE );
+        printf( "%10.3f\n", (now() - start) * 1e9 / ((double)iterations * BUFFER_SIZE) );
+    }
+
+    start = now();
+    for( it = 0; it < iterations; it++ )
+        pcm_stereo( PCM_FLOAT32, out, left, right, BUFFER_SIZE );
+    printf( "%-8s%10.3f\n", "float", (now() - start) * 1e9 / ((double)iterations * BUFFER_SIZE) );
+
+    return 0;
+}
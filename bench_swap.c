@@ -0,0 +1,131 @@
+//-----------------------------------------------------------------------------
+// name: bench_swap.c
+// desc: block timing while files are swapped under the audio thread
+//
+//   plays every slice of a file through engine_render() at the pace a
+//   sound card would ask for blocks, while another thread replaces the
+//   file with a second one a third of the way in and swaps the first back
+//   at two thirds.  prints the usual callback timing and counts the
+//   blocks that missed their deadline.
+//
+//   once the files have .decoded caches, drop the page cache before a run
+//   (echo 3 > /proc/sys/vm/drop_caches on linux) to check that loading a
+//   cold cache doesn't cost the audio thread page faults.
+//
+//   usage: bench_swap <audio file> <replacement file> [number of slices]
+//                     [seconds]
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "engine.h"
+#include "stats.h"
+
+
+typedef struct {
+    const char * files[2];
+    double seconds;
+} swapPlan;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: swapper()
+// desc: control thread, replaces file 0 twice
+//-----------------------------------------------------------------------------
+static void * swapper( void * arg )
+{
+    swapPlan * plan = (swapPlan *)arg;
+    struct timespec ts;
+    int i;
+
+    for( i = 1; i <= 2; i++ )
+    {
+        ts.tv_sec = (time_t)(plan->seconds / 3);
+        ts.tv_nsec = (long)((plan->seconds / 3 - ts.tv_sec) * 1e9);
+        nanosleep( &ts, NULL );
+        printf( "swapping in %s\n", plan->files[i % 2] );
+        engine_replace_file( 0, plan->files[i % 2] );
+    }
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: ...
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    static float out[BUFFER_SIZE * STEREO];
+    int numSlices = argc > 3 ? atoi( argv[3] ) : DEFAULT_SLICES;
+    double period = (double)BUFFER_SIZE / SAMPLING_RATE;
+    unsigned long long start, late = 0;
+    callbackStats stats;
+    struct timespec due;
+    pthread_t thread;
+    swapPlan plan;
+    long blocks, b;
+    int s;
+
+    if( argc < 3 )
+    {
+        printf( "usage: bench_swap <audio file> <replacement file> [number of slices]\n" );
+        printf( "                  [seconds]\n" );
+        return 1;
+    }
+    if( numSlices < 1 || numSlices > MAX_SLICES )
+    {
+        printf( "number of slices must be between 1 and %d\n", MAX_SLICES );
+        return 1;
+    }
+    plan.files[0] = argv[1];
+    plan.files[1] = argv[2];
+    plan.seconds = argc > 4 ? atof( argv[4] ) : DEFAULT_RENDER_SECONDS;
+    blocks = (long)(plan.seconds / period);
+
+    if( engine_init( argv[1], numSlices ) != 0 )
+        return 1;
+    for( s = 0; s < numSlices; s++ )
+        engine_send( CMD_STARTSTOP, s, 0 );
+
+    stats_init( &stats, period );
+    if( pthread_create( &thread, NULL, swapper, &plan ) != 0 )
+    {
+        engine_free();
+        return 1;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &due );
+    for( b = 0; b < blocks; b++ )
+    {
+        start = stats_now();
+        engine_render( out, BUFFER_SIZE );
+        engine_publish();
+        stats_record( &stats, start, 0, 0 );
+        if( (stats_now() - start) * 1e-9 > period )
+            late++;
+
+        // next block is due one period after this one was
+        due.tv_nsec += (long)(period * 1e9);
+        while( due.tv_nsec >= 1000000000 )
+        {
+            due.tv_sec++;
+            due.tv_nsec -= 1000000000;
+        }
+        clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL );
+    }
+    pthread_join( thread, NULL );
+
+    stats_print( &stats, stdout );
+    printf( "%ld blocks, %llu past their deadline\n", blocks, late );
+    engine_free();
+
+    return late != 0;
+}
@@ -0,0 +1,378 @@
+//-----------------------------------------------------------------------------
+// name: biquad.c
+// desc: per-slice iir filter, a cascade of biquad sections
+//
+//   a recursive filter can't take several frames of one channel at once,
+//   so the vector path takes two sections at once instead: lanes are
+//   { first L, first R, second L, second R } and the second section runs
+//   one frame behind the first, picking up what it put out the step
+//   before.  one 4-wide update per frame then covers two sections of
+//   stereo with no shuffling beyond moving a frame in and out.
+//-----------------------------------------------------------------------------
+#include "biquad.h"
+#include <math.h>
+#include <string.h>
+
+#if defined( __SSE2__ )
+  #define BIQUAD_SSE2 1
+  #include <emmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+  #define BIQUAD_NEON 1
+  #include <arm_neon.h>
+#endif
+
+#define BIQUAD_PI               3.14159265358979323846
+#define BIQUAD_DENORMAL         1e-15f//state below this is flushed to zero
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: section_off()
+// desc: true if the section would pass the signal unchanged
+//-----------------------------------------------------------------------------
+static int section_off( const biquadSection * s )
+{
+    switch( s->type )
+    {
+        case BIQUAD_OFF:
+            return 1;
+        case BIQUAD_LOWSHELF:
+        case BIQUAD_HIGHSHELF:
+        case BIQUAD_PEAK:
+            return s->gain == 0;
+        default:
+            return 0;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: section_coefficients()
+// desc: audio eq cookbook, worked out in double and normalised by a0
+//-----------------------------------------------------------------------------
+static void section_coefficients( biquadSection * s, float rate )
+{
+    double freq = s->freq, q = s->q, w, cs, sn, alpha, A, sq;
+    double b0 = 1, b1 = 0, b2 = 0, a0 = 1, a1 = 0, a2 = 0;
+
+    if( freq > 0.49 * rate )
+        freq = 0.49 * rate;
+    if( freq < 1 )
+        freq = 1;
+    if( q < 0.05 )
+        q = 0.05;
+
+    w = 2 * BIQUAD_PI * freq / rate;
+    cs = cos( w );
+    sn = sin( w );
+    alpha = sn / (2 * q);
+    A = pow( 10, s->gain / 40. );
+    sq = 2 * sqrt( A ) * alpha;
+
+    switch( section_off( s ) ? BIQUAD_OFF : s->type )
+    {
+        case BIQUAD_OFF:
+            break;
+        case BIQUAD_LOWPASS:
+            b0 = (1 - cs) / 2; b1 = 1 - cs; b2 = (1 - cs) / 2;
+            a0 = 1 + alpha; a1 = -2 * cs; a2 = 1 - alpha;
+            break;
+        case BIQUAD_HIGHPASS:
+            b0 = (1 + cs) / 2; b1 = -(1 + cs); b2 = (1 + cs) / 2;
+            a0 = 1 + alpha; a1 = -2 * cs; a2 = 1 - alpha;
+            break;
+        case BIQUAD_BANDPASS:
+            b0 = alpha; b1 = 0; b2 = -alpha;
+            a0 = 1 + alpha; a1 = -2 * cs; a2 = 1 - alpha;
+            break;
+        case BIQUAD_LOWSHELF:
+            b0 = A * ((A + 1) - (A - 1) * cs + sq);
+            b1 = 2 * A * ((A - 1) - (A + 1) * cs);
+            b2 = A * ((A + 1) - (A - 1) * cs - sq);
+            a0 = (A + 1) + (A - 1) * cs + sq;
+            a1 = -2 * ((A - 1) + (A + 1) * cs);
+            a2 = (A + 1) + (A - 1) * cs - sq;
+            break;
+        case BIQUAD_HIGHSHELF:
+            b0 = A * ((A + 1) + (A - 1) * cs + sq);
+            b1 = -2 * A * ((A - 1) + (A + 1) * cs);
+            b2 = A * ((A + 1) + (A - 1) * cs - sq);
+            a0 = (A + 1) - (A - 1) * cs + sq;
+            a1 = 2 * ((A - 1) - (A + 1) * cs);
+            a2 = (A + 1) - (A - 1) * cs - sq;
+            break;
+        case BIQUAD_PEAK:
+            b0 = 1 + alpha * A; b1 = -2 * cs; b2 = 1 - alpha * A;
+            a0 = 1 + alpha / A; a1 = -2 * cs; a2 = 1 - alpha / A;
+            break;
+    }
+
+    s->b0 = (float)(b0 / a0);
+    s->b1 = (float)(b1 / a0);
+    s->b2 = (float)(b2 / a0);
+    s->a1 = (float)(a1 / a0);
+    s->a2 = (float)(a2 / a0);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: biquad_init()
+// desc: ...
+//-----------------------------------------------------------------------------
+void biquad_init( biquadCascade * bq, float rate )
+{
+    int i;
+
+    memset( bq, 0, sizeof(*bq) );
+    bq->rate = rate;
+    for( i = 0; i < BIQUAD_SECTIONS; i++ )
+    {
+        bq->section[i].type = BIQUAD_OFF;
+        bq->section[i].q = BIQUAD_Q;
+        section_coefficients( &bq->section[i], rate );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: biquad_reset()
+// desc: ...
+//-----------------------------------------------------------------------------
+void biquad_reset( biquadCascade * bq )
+{
+    memset( bq->z1, 0, sizeof(bq->z1) );
+    memset( bq->z2, 0, sizeof(bq->z2) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: biquad_set()
+// desc: a section that comes back from off starts from silence instead of
+//       whatever it held when it was switched off
+//-----------------------------------------------------------------------------
+int biquad_set( biquadCascade * bq, int section, biquadType type,
+                float freq, float q, float gain )
+{
+    biquadSection * s;
+    int wasOff, i;
+
+    if( section < 0 || section >= BIQUAD_SECTIONS )
+        return -1;
+
+    s = &bq->section[section];
+    if( s->type == type && s->freq == freq && s->q == q && s->gain == gain )
+        return 0;
+
+    wasOff = section_off( s );
+    s->type = type;
+    s->freq = freq;
+    s->q = q;
+    s->gain = gain;
+    section_coefficients( s, bq->rate );
+    if( wasOff && !section_off( s ) )
+    {
+        bq->z1[section][0] = bq->z1[section][1] = 0;
+        bq->z2[section][0] = bq->z2[section][1] = 0;
+    }
+
+    bq->count = 0;
+    for( i = 0; i < BIQUAD_SECTIONS; i++ )
+        if( !section_off( &bq->section[i] ) )
+            bq->count = i + 1;
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: biquad_neutral()
+// desc: ...
+//-----------------------------------------------------------------------------
+int biquad_neutral( const biquadCascade * bq )
+{
+    return bq->count == 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: process_one()
+// desc: one section over the block, both channels
+//-----------------------------------------------------------------------------
+static void process_one( const biquadSection * s, float * z1, float * z2,
+                         float * x, long frames )
+{
+    float b0 = s->b0, b1 = s->b1, b2 = s->b2, a1 = s->a1, a2 = s->a2;
+    float l1 = z1[0], r1 = z1[1], l2 = z2[0], r2 = z2[1];
+    float l, r, yl, yr;
+    long i;
+
+    for( i = 0; i < frames; i++ )
+    {
+        l = x[2*i]; r = x[2*i+1];
+        yl = b0 * l + l1; yr = b0 * r + r1;
+        l1 = b1 * l - a1 * yl + l2; r1 = b1 * r - a1 * yr + r2;
+        l2 = b2 * l - a2 * yl; r2 = b2 * r - a2 * yr;
+        x[2*i] = yl; x[2*i+1] = yr;
+    }
+
+    z1[0] = l1; z1[1] = r1; z2[0] = l2; z2[1] = r2;
+}
+
+
+
+
+#ifdef BIQUAD_SSE2
+//-----------------------------------------------------------------------------
+// name: process_two()
+// desc: sections s and s+1 over the block, skewed by a frame (see top)
+//-----------------------------------------------------------------------------
+static void process_two( const biquadSection * s, float (* z1)[2], float (* z2)[2],
+                         float * x, long frames )
+{
+    __m128 b0 = _mm_setr_ps( s[0].b0, s[0].b0, s[1].b0, s[1].b0 );
+    __m128 b1 = _mm_setr_ps( s[0].b1, s[0].b1, s[1].b1, s[1].b1 );
+    __m128 b2 = _mm_setr_ps( s[0].b2, s[0].b2, s[1].b2, s[1].b2 );
+    __m128 a1 = _mm_setr_ps( s[0].a1, s[0].a1, s[1].a1, s[1].a1 );
+    __m128 a2 = _mm_setr_ps( s[0].a2, s[0].a2, s[1].a2, s[1].a2 );
+    __m128 w1 = _mm_setr_ps( z1[0][0], z1[0][1], z1[1][0], z1[1][1] );
+    __m128 w2 = _mm_setr_ps( z2[0][0], z2[0][1], z2[1][0], z2[1][1] );
+    __m128 zero = _mm_setzero_ps(), in, y, n1, n2;
+    long i;
+
+    // first frame: only the first section has an input yet
+    in = _mm_loadl_pi( zero, (const __m64 *)x );
+    y = _mm_add_ps( _mm_mul_ps( b0, in ), w1 );
+    n1 = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( b1, in ), _mm_mul_ps( a1, y ) ), w2 );
+    n2 = _mm_sub_ps( _mm_mul_ps( b2, in ), _mm_mul_ps( a2, y ) );
+    w1 = _mm_shuffle_ps( n1, w1, _MM_SHUFFLE( 3, 2, 1, 0 ) );
+    w2 = _mm_shuffle_ps( n2, w2, _MM_SHUFFLE( 3, 2, 1, 0 ) );
+
+    for( i = 1; i < frames; i++ )
+    {
+        in = _mm_movelh_ps( _mm_loadl_pi( zero, (const __m64 *)(x + 2*i) ), y );
+        y = _mm_add_ps( _mm_mul_ps( b0, in ), w1 );
+        w1 = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( b1, in ), _mm_mul_ps( a1, y ) ), w2 );
+        w2 = _mm_sub_ps( _mm_mul_ps( b2, in ), _mm_mul_ps( a2, y ) );
+        _mm_storeh_pi( (__m64 *)(x + 2*(i-1)), y );
+    }
+
+    // last frame: only the second section has an input left
+    in = _mm_movelh_ps( zero, y );
+    y = _mm_add_ps( _mm_mul_ps( b0, in ), w1 );
+    n1 = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( b1, in ), _mm_mul_ps( a1, y ) ), w2 );
+    n2 = _mm_sub_ps( _mm_mul_ps( b2, in ), _mm_mul_ps( a2, y ) );
+    w1 = _mm_shuffle_ps( w1, n1, _MM_SHUFFLE( 3, 2, 1, 0 ) );
+    w2 = _mm_shuffle_ps( w2, n2, _MM_SHUFFLE( 3, 2, 1, 0 ) );
+    _mm_storeh_pi( (__m64 *)(x + 2*(frames-1)), y );
+
+    _mm_storel_pi( (__m64 *)z1[0], w1 );
+    _mm_storeh_pi( (__m64 *)z1[1], w1 );
+    _mm_storel_pi( (__m64 *)z2[0], w2 );
+    _mm_storeh_pi( (__m64 *)z2[1], w2 );
+}
+#endif
+
+
+
+
+#ifdef BIQUAD_NEON
+//-----------------------------------------------------------------------------
+// name: process_two()
+// desc: sections s and s+1 over the block, skewed by a frame (see top)
+//-----------------------------------------------------------------------------
+static void process_two( const biquadSection * s, float (* z1)[2], float (* z2)[2],
+                         float * x, long frames )
+{
+    const float cb0[4] = { s[0].b0, s[0].b0, s[1].b0, s[1].b0 };
+    const float cb1[4] = { s[0].b1, s[0].b1, s[1].b1, s[1].b1 };
+    const float cb2[4] = { s[0].b2, s[0].b2, s[1].b2, s[1].b2 };
+    const float ca1[4] = { s[0].a1, s[0].a1, s[1].a1, s[1].a1 };
+    const float ca2[4] = { s[0].a2, s[0].a2, s[1].a2, s[1].a2 };
+    float32x4_t b0 = vld1q_f32( cb0 ), b1 = vld1q_f32( cb1 ), b2 = vld1q_f32( cb2 );
+    float32x4_t a1 = vld1q_f32( ca1 ), a2 = vld1q_f32( ca2 );
+    float32x4_t w1 = vcombine_f32( vld1_f32( z1[0] ), vld1_f32( z1[1] ) );
+    float32x4_t w2 = vcombine_f32( vld1_f32( z2[0] ), vld1_f32( z2[1] ) );
+    float32x2_t zero = vdup_n_f32( 0 );
+    float32x4_t in, y, n1, n2;
+    long i;
+
+    // first frame: only the first section has an input yet
+    in = vcombine_f32( vld1_f32( x ), zero );
+    y = vmlaq_f32( w1, b0, in );
+    n1 = vaddq_f32( vmlsq_f32( vmulq_f32( b1, in ), a1, y ), w2 );
+    n2 = vmlsq_f32( vmulq_f32( b2, in ), a2, y );
+    w1 = vcombine_f32( vget_low_f32( n1 ), vget_high_f32( w1 ) );
+    w2 = vcombine_f32( vget_low_f32( n2 ), vget_high_f32( w2 ) );
+
+    for( i = 1; i < frames; i++ )
+    {
+        in = vcombine_f32( vld1_f32( x + 2*i ), vget_low_f32( y ) );
+        y = vmlaq_f32( w1, b0, in );
+        w1 = vaddq_f32( vmlsq_f32( vmulq_f32( b1, in ), a1, y ), w2 );
+        w2 = vmlsq_f32( vmulq_f32( b2, in ), a2, y );
+        vst1_f32( x + 2*(i-1), vget_high_f32( y ) );
+    }
+
+    // last frame: only the second section has an input left
+    in = vcombine_f32( zero, vget_low_f32( y ) );
+    y = vmlaq_f32( w1, b0, in );
+    n1 = vaddq_f32( vmlsq_f32( vmulq_f32( b1, in ), a1, y ), w2 );
+    n2 = vmlsq_f32( vmulq_f32( b2, in ), a2, y );
+    w1 = vcombine_f32( vget_low_f32( w1 ), vget_high_f32( n1 ) );
+    w2 = vcombine_f32( vget_low_f32( w2 ), vget_high_f32( n2 ) );
+    vst1_f32( x + 2*(frames-1), vget_high_f32( y ) );
+
+    vst1_f32( z1[0], vget_low_f32( w1 ) );
+    vst1_f32( z1[1], vget_high_f32( w1 ) );
+    vst1_f32( z2[0], vget_low_f32( w2 ) );
+    vst1_f32( z2[1], vget_high_f32( w2 ) );
+}
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: biquad_process()
+// desc: sections in pairs where there is a vector unit, state that has
+//       decayed to nearly nothing is flushed so silence doesn't run on
+//       denormals
+//-----------------------------------------------------------------------------
+void biquad_process( biquadCascade * bq, float * buffer, long frames )
+{
+    int i = 0, c;
+
+    if( frames <= 0 )
+        return;
+
+#if defined( BIQUAD_SSE2 ) || defined( BIQUAD_NEON )
+    for( ; i + 2 <= bq->count; i += 2 )
+        process_two( &bq->section[i], &bq->z1[i], &bq->z2[i], buffer, frames );
+#endif
+    for( ; i < bq->count; i++ )
+        process_one( &bq->section[i], bq->z1[i], bq->z2[i], buffer, frames );
+
+    for( i = 0; i < bq->count; i++ )
+    {
+        for( c = 0; c < 2; c++ )
+        {
+            if( fabsf( bq->z1[i][c] ) < BIQUAD_DENORMAL )
+                bq->z1[i][c] = 0;
+            if( fabsf( bq->z2[i][c] ) < BIQUAD_DENORMAL )
+                bq->z2[i][c] = 0;
+        }
+    }
+}
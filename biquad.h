@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// name: biquad.h
+// desc: per-slice iir filter, a cascade of biquad sections
+//
+//   each section is a second order filter (robert bristow-johnson's audio
+//   eq cookbook) run in transposed direct form II on interleaved stereo.
+//   there is no block latency, the cost is a handful of multiplies per
+//   sample per section, and coefficients are only worked out again when
+//   a section's settings change.
+//-----------------------------------------------------------------------------
+#ifndef __BIQUAD_H__
+#define __BIQUAD_H__
+
+
+#define BIQUAD_SECTIONS         4//sections per cascade
+#define BIQUAD_Q                0.70710678f//butterworth, no resonant bump
+
+typedef enum {
+    BIQUAD_OFF,//passes everything, costs nothing
+    BIQUAD_LOWPASS,
+    BIQUAD_HIGHPASS,
+    BIQUAD_BANDPASS,//0 dB at freq
+    BIQUAD_LOWSHELF,
+    BIQUAD_HIGHSHELF,
+    BIQUAD_PEAK
+} biquadType;
+
+typedef struct {
+    // settings
+    biquadType type;
+    float freq;             // cutoff or centre, Hz
+    float q;
+    float gain;             // dB, shelf and peak only
+    // coefficients, normalised so a0 = 1
+    float b0, b1, b2, a1, a2;
+} biquadSection;
+
+typedef struct {
+    float rate;             // sample rate, Hz
+    int count;              // sections in use, the ones after are off
+    biquadSection section[BIQUAD_SECTIONS];
+    // transposed direct form ii state, [section][channel]
+    float z1[BIQUAD_SECTIONS][2];
+    float z2[BIQUAD_SECTIONS][2];
+} biquadCascade;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// every section off and silent state
+void biquad_init( biquadCascade * bq, float rate );
+// clear the state but keep the settings
+void biquad_reset( biquadCascade * bq );
+// change one section, coefficients are only recomputed if something moved;
+// returns -1 if there is no such section
+int biquad_set( biquadCascade * bq, int section, biquadType type,
+                float freq, float q, float gain );
+// true if the cascade would leave the signal alone
+int biquad_neutral( const biquadCascade * bq );
+// filter frames of interleaved stereo in place
+void biquad_process( biquadCascade * bq, float * buffer, long frames );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
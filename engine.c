@@ -0,0 +1,1034 @@
+//-----------------------------------------------------------------------------
+// name: engine.c
+// desc: slice sampler audio engine
+//
+//   Lucas Hanson & Carrie Sutherland
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sndfile.h>//libsndfile library
+#include "engine.h"
+#include "fft.h"
+#include "samplestore.h"
+#include "samplepool.h"
+#include "mixer.h"
+#include "pcm.h"
+#include "ringbuffer.h"
+#include "biquad.h"
+#include "workerpool.h"
+#include "renderahead.h"
+
+
+//-----------------------------------------------------------------------------
+// global variables and #defines
+//-----------------------------------------------------------------------------
+#define INIT_START              0
+#define INIT_VOLUME             0.8
+#define DEFAULT_LOOP_LENGTH     100000
+#define INC_LOOP_LENGTH         25000
+#define FILTER_MIN_HZ           20//highpass here is off
+#define FILTER_MAX_HZ           20000//lowpass here is off
+#define FILTER_STEP             1.12246205f//a whole tone per key press
+#define FILTER_STEPS            60//whole tones from one edge to the other
+#ifndef WINDOW_SIZE
+#define WINDOW_SIZE             (BUFFER_SIZE/4)//filter window, power of 2 up to 4096
+#endif
+#define HOP_SIZE                (WINDOW_SIZE/2)
+#define MASK_BINS               (WINDOW_SIZE/2 + 1)//dc up to nyquist
+#define MASK_EDGE               (WINDOW_SIZE/64)//bins the mask takes to fade out
+#define MASK_PI                 3.14159265f
+#define VOLUME_INCR             0.1
+#define COMMAND_QUEUE_SIZE      256//power of 2
+#define PARALLEL_MIN_SLICES     4//fewer slices than this are rendered inline
+
+//individual slice data, the parts the mixer doesn't touch every frame
+typedef struct {
+    int lowpassSteps;//whole tones the cutoff is in from FILTER_MAX_HZ
+    int highpassSteps;//whole tones the cutoff is in from FILTER_MIN_HZ
+    float lowpass;//cutoff, Hz, worked out from the steps
+    float highpass;//cutoff, Hz, worked out from the steps
+    float buffer[BUFFER_SIZE * STEREO];
+    bool filterOn;//a cutoff has moved in from the edge of the audible range
+    bool filterLive;//filtered last block, so the filter holds a tail
+    biquadCascade eq;//highpass then lowpass, remade when a cutoff changes
+    float mask[MASK_BINS];//the same for the stft filter, gain per bin
+    stft_context stft;//filter state and scratch, so slices can be filtered in parallel
+
+} slice;
+
+//slice table, hot fields are kept as one array per field so the mixer
+//walks contiguous memory across slices
+typedef struct {
+    int count;//number of active slices
+    bool playing[MAX_SLICES];
+    int file[MAX_SLICES];//pool index of the file the slice plays
+    long long start[MAX_SLICES];//frame offset into the file
+    long long loopCounter[MAX_SLICES];//position inside the loop
+    long long loopLength[MAX_SLICES];
+    float volume[MAX_SLICES];
+    float muter[MAX_SLICES];
+    slice slices[MAX_SLICES];
+} sliceTable;
+
+typedef struct {
+    commandType type;
+    int slice;
+    int amount;
+} command;
+
+typedef struct {
+    samplePool *files;//every file the slices can play
+    sliceTable slices;//owned by the audio thread
+    ringbuffer commands;//GUI -> audio thread
+    workerPool *pool;//renders slices alongside the audio thread
+    renderAhead *ahead;//render-ahead mode, NULL when the callback renders
+    atomic_ullong missed;//blocks render-ahead didn't have ready in time
+    size_t budget;//bytes of decoded audio to keep in memory, 0 for the default
+    bool compact;//keep integer files packed instead of as float
+    bool stft;//filter with the fft mask instead of the biquads
+    //members for the stft filter, each slice's stft_context holds its own state
+    float window[WINDOW_SIZE];
+    fft_plan *plan;//WINDOW_SIZE stereo frames as one complex fft, shared by every slice
+
+} sndFile;
+
+//Initialize sound file struct and slices
+static sndFile data;
+
+//Published slice state, triple buffered so neither thread ever waits:
+//the audio thread fills stateBack and swaps it into the middle slot, the
+//GUI swaps the middle slot into stateFront when it holds something new
+#define STATE_FRESH             4
+static sliceState g_states[3];
+static atomic_int g_stateMiddle = 1;
+static int g_stateBack = 0;
+static int g_stateFront = 2;
+
+
+//-----------------------------------------------------------------------------
+// function prototypes
+//-----------------------------------------------------------------------------
+static void applyCommands();
+static void renderMix(float *out, unsigned long frames);
+static void renderNextBlock(void *user, float *out, unsigned long frames);
+static void publishState();
+static void renderSlice(void *frames, int s);
+static void filter(stft_context *ctx, float *buffer, unsigned long frames, const float *mask);
+static void maskStereo(stft_context *ctx, void *mask);
+static void maskSpectrum(float *spectrum, const float *mask);
+static void filterSlice(int s, unsigned long frames);
+static void resetFilter(int s);
+static void setCutoffs(int s);
+static void makeMask(int s);
+static float maskEdge(float d);
+static void startstop(int s);
+static void increaseLoopLength(int s);
+static void decreaseLoopLength(int s);
+static void nudgeLocation(int s, int nudgeAmount);
+static void setFile(int s, int file);
+static long long loopRegion(int s, long long frames);
+static void wantSlices(void);
+static void readSlice(int s, unsigned long frames);
+static void muteSlice(int s);
+static void volumeIncrease(int s);
+static void volumeDecrease(int s);
+static void decreaseLowpass(int s);
+static void increaseLowpass(int s);
+static void decreaseHighpass(int s);
+static void increaseHighpass(int s);
+
+
+//-----------------------------------------------------------------------------
+// Name: engine_init( )
+// Desc: Loads the audio file and sets up the slices, returns 0 on success
+//-----------------------------------------------------------------------------
+int engine_init(const char * audioFilename, int numSlices) {
+    const samplestore *store;
+    SNDFILE *file;
+    SF_INFO info;
+    long long frames;
+    int i, rate;
+
+    //check the length from the header first, a file that is too short is
+    //never decoded and never leaves a cache behind
+    memset(&info, 0, sizeof(info));
+    if ((file = sf_open(audioFilename, SFM_READ, &info)) == NULL) {
+        printf ("Error: could not open file: %s\n", audioFilename) ;
+        puts(sf_strerror(NULL));
+        return -1;
+    }
+    sf_close(file);
+    if (info.samplerate <= 0 || info.frames / info.samplerate < 10) {
+        printf("Error: Audio file must be at least 10 seconds in length.\n");
+        return -1;
+    }
+
+    //Every file the slices play is loaded into the pool off the audio
+    //thread, files too big for the budget are streamed in pages
+    pcm_init();
+    data.files = spool_create(data.budget != 0 ? data.budget : STORE_DEFAULT_BUDGET,
+                              data.compact ? STORE_COMPACT : STORE_FLOAT);
+    if (data.files == NULL) {
+        printf("Error: could not start the file loader\n");
+        return -1;
+    }
+    if (engine_add_file(audioFilename) != 0) {
+        spool_free(data.files);
+        data.files = NULL;
+        return -1;
+    }
+
+    //every slice starts on the first file, loaded before the first block
+    for (i = 0; i < numSlices; i++) {
+        data.slices.file[i] = 0;
+        spool_ref(data.files, 0);
+    }
+    if (spool_sync(data.files) != 0) {
+        printf ("Error: could not open file: %s\n", audioFilename) ;
+        spool_free(data.files);
+        data.files = NULL;
+        return -1;
+    }
+    spool_enter(data.files);
+    store = spool_store(data.files, 0);
+    rate = store->samplerate;
+    frames = store->frames;
+
+    printf("Audio file: Frames: %lld Channels: %d Samplerate: %d Samples: %s%s\n\n", 
+            store->frames, store->channels, store->samplerate, pcm_format_name(store->format),
+            store->pager != NULL ? " (streamed)" :
+            store->map != NULL ? " (mapped from cache)" : "");
+    spool_leave(data.files);
+
+    //again for what actually decoded, the header can promise more
+    if (rate <= 0 || frames / rate < 10){
+        printf("Error: Audio file must be at least 10 seconds in length.\n");
+        spool_free(data.files);
+        data.files = NULL;
+        return -1;
+    }
+ 
+    //the window and plan are only for the stft filter
+    if (data.stft) {
+        hanning(data.window, WINDOW_SIZE);
+        data.plan = fft_plan_create(WINDOW_SIZE);
+        if (data.plan == NULL) {
+            printf("Error: could not allocate fft plan\n");
+            spool_free(data.files);
+            data.files = NULL;
+            return -1;
+        }
+    }
+    printf("Filter: %s\n", data.stft ? "stft" : "biquad");
+    mix_init();
+    printf("Mixer: %s\n", mix_kernel_name());
+    if (data.compact) {
+        printf("Sample conversion: %s\n", pcm_kernel_name());
+    }
+
+    //Initilialize struct data
+    if (rb_init(&data.commands, sizeof(command), COMMAND_QUEUE_SIZE) != 0) {
+        printf("Error: could not allocate command queue\n");
+        fft_plan_free(data.plan);
+        spool_free(data.files);
+        data.files = NULL;
+        return -1;
+    }
+    //Slice initialization, starts spread evenly through the file
+    data.slices.count = numSlices;
+    for (i = 0; i < numSlices; i++) {
+        data.slices.playing[i] = false;
+        data.slices.start[i] = i * (frames / numSlices);
+        data.slices.loopCounter[i] = 0;
+        data.slices.loopLength[i] = DEFAULT_LOOP_LENGTH;
+        data.slices.volume[i] = INIT_VOLUME;
+        data.slices.muter[i] = 1.0;
+        data.slices.slices[i].highpassSteps = 0;
+        data.slices.slices[i].lowpassSteps = 0;
+        data.slices.slices[i].filterLive = false;
+        biquad_init(&data.slices.slices[i].eq, SAMPLING_RATE);
+        setCutoffs(i);
+        if (data.stft &&
+            stft_init(&data.slices.slices[i].stft, data.plan, data.window, HOP_SIZE) != 0) {
+            printf("Error: could not allocate filter state\n");
+            data.slices.count = i + 1;
+            engine_free();
+            return -1;
+        }
+    }
+    //workers for the slices, without them everything runs inline
+    data.pool = pool_create(POOL_AUTO, PARALLEL_MIN_SLICES);
+    printf("Workers: %d\n", pool_threads(data.pool));
+
+    //first pages of every slice
+    wantSlices();
+
+    //give the GUI something to draw before the first callback
+    engine_publish();
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name: engine_add_file( )
+// Desc: Adds a file slices can be switched to with CMD_FILE, it loads in
+//       the background.  Returns its index, or -1 if it can't be opened
+//-----------------------------------------------------------------------------
+int engine_add_file(const char *audioFilename) {
+    int file = spool_add(data.files, audioFilename);
+
+    if (file < 0) {
+        printf ("Error: could not open file: %s\n", audioFilename) ;
+        puts(sf_strerror (NULL)) ;
+    }
+    return file;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_replace_file( )
+// Desc: Loads another file in the background and swaps it in for a pooled
+//       one between two blocks, slices on it keep their place.  Returns 0
+//       once the load is queued, -1 if the file can't be opened
+//-----------------------------------------------------------------------------
+int engine_replace_file(int file, const char *audioFilename) {
+    if (spool_replace(data.files, file, audioFilename) != 0) {
+        printf ("Error: could not open file: %s\n", audioFilename) ;
+        return -1;
+    }
+    return 0;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_file_count( ) / engine_file_name( )
+// Desc: files added so far, index 0 is the one engine_init loaded
+//-----------------------------------------------------------------------------
+int engine_file_count() {
+    return data.files != NULL ? spool_count(data.files) : 0;
+}
+const char *engine_file_name(int file) {
+    return spool_name(data.files, file);
+}
+//-----------------------------------------------------------------------------
+// Name: engine_memory_budget( )
+// Desc: Bytes of decoded audio engine_init may keep in memory, files that
+//       need more are streamed.  0 restores the default
+//-----------------------------------------------------------------------------
+void engine_memory_budget(size_t bytes) {
+    data.budget = bytes;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_compact_samples( )
+// Desc: Keep 16 and 24-bit files packed at their own depth, converted to
+//       float as the slices read them
+//-----------------------------------------------------------------------------
+void engine_compact_samples(bool on) {
+    data.compact = on;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_stft_filter( )
+// Desc: Filter slices with the fft mask instead of the biquads
+//-----------------------------------------------------------------------------
+void engine_stft_filter(bool on) {
+    data.stft = on;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_cache_dir( )
+// Desc: Where decoded files are cached, NULL for the default and "" for
+//       none
+//-----------------------------------------------------------------------------
+void engine_cache_dir(const char * dir) {
+    store_cache_dir(dir);
+}
+//-----------------------------------------------------------------------------
+// Name: engine_print_files( )
+// Desc: Each file's format and the memory its audio takes right now
+//-----------------------------------------------------------------------------
+void engine_print_files() {
+    int i;
+
+    for (i = 0; i < engine_file_count(); i++) {
+        printf("File %d: %s, %s, %.1f MB resident\n", i + 1, spool_name(data.files, i),
+                pcm_format_name(spool_format(data.files, i)),
+                spool_resident(data.files, i) / 1048576.0);
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: engine_free( )
+// Desc: Releases the sample pool, the fft plan and the command queue
+//-----------------------------------------------------------------------------
+void engine_free() {
+    int i;
+
+    ahead_free(data.ahead);
+    data.ahead = NULL;
+    pool_free(data.pool);
+    data.pool = NULL;
+    for (i = 0; i < data.slices.count; i++) {
+        stft_free(&data.slices.slices[i].stft);
+    }
+    data.slices.count = 0;
+    spool_free(data.files);
+    data.files = NULL;
+    fft_plan_free(data.plan);
+    data.plan = NULL;
+    rb_free(&data.commands);
+}
+
+//-----------------------------------------------------------------------------
+// Name: engine_render_ahead( )
+// Desc: Switches to render-ahead, call between engine_init and the first
+//       engine_render.  Returns 0 on success
+//-----------------------------------------------------------------------------
+int engine_render_ahead() {
+    if (data.ahead == NULL) {
+        atomic_store(&data.missed, 0);
+        data.ahead = ahead_create(renderNextBlock, NULL, BUFFER_SIZE);
+        if (data.ahead == NULL) {
+            printf("Error: could not start the render-ahead thread\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_missed_blocks( )
+// Desc: callbacks render-ahead couldn't fill in time
+//-----------------------------------------------------------------------------
+unsigned long long engine_missed_blocks() {
+    return atomic_load(&data.missed);
+}
+//-----------------------------------------------------------------------------
+// Name: engine_render( )
+// Desc: renders one block of the mix, called from the audio thread.  in
+//       render-ahead mode the block is already done and only copied out
+//-----------------------------------------------------------------------------
+void engine_render(float *out, unsigned long framesPerBuffer)
+{
+    if (data.ahead != NULL) {
+        if (ahead_read(data.ahead, out, framesPerBuffer) != 0) {
+            atomic_store_explicit(&data.missed,
+                    atomic_load_explicit(&data.missed, memory_order_relaxed) + 1,
+                    memory_order_relaxed);
+        }
+        return;
+    }
+    renderMix(out, framesPerBuffer);
+}
+//-----------------------------------------------------------------------------
+// Name: renderNextBlock( )
+// Desc: render-ahead thread: one block, then the state the GUI sees, since
+//       this thread owns the slice table now
+//-----------------------------------------------------------------------------
+static void renderNextBlock(void *user, float *out, unsigned long frames)
+{
+    renderMix(out, frames);
+    publishState();
+}
+//-----------------------------------------------------------------------------
+// Name: renderMix( )
+// Desc: renders one block of the mix on whichever thread owns the slices
+//-----------------------------------------------------------------------------
+static void renderMix(float *out, unsigned long framesPerBuffer)
+{
+    const float *src[MAX_SLICES];
+    float gain[MAX_SLICES];
+    int j, active = 0;
+
+    /* no file the block reads is freed before the block is done */
+    spool_enter(data.files);
+
+    /* pick up GUI edits at the block boundary */
+    applyCommands();
+
+    /* slices are independent until the mix, so they go out to the pool */
+    pool_run(data.pool, renderSlice, &framesPerBuffer, data.slices.count);
+
+    /* effective gain once per block, silent slices are left out of the mix */
+    for (j = 0; j < data.slices.count; j++) {
+        float g = data.slices.volume[j] * data.slices.muter[j];
+        if (g != 0) {
+            src[active] = data.slices.slices[j].buffer;
+            gain[active] = g;
+            active++;
+        }
+    }
+
+    /* combine samples adjusted for volume from each slice for each channel */
+    mix_slices(out, src, gain, active, framesPerBuffer * STEREO);
+
+    /* tell the pager where every loop is now */
+    wantSlices();
+    spool_leave(data.files);
+
+}
+//-----------------------------------------------------------------------------
+// Name: engine_render_file( )
+// Desc: plays every slice through the normal render path as fast as the CPU
+//       allows and writes the mix to a file
+//-----------------------------------------------------------------------------
+int engine_render_file(const char *outFilename, double seconds, callbackStats *stats) {
+    float out[BUFFER_SIZE * STEREO];
+    SNDFILE *outfile;
+    SF_INFO info;
+    long total = (long)(seconds * SAMPLING_RATE);
+    long done = 0;
+    struct timespec begin, end;
+    double elapsed;
+    int i;
+
+    //offline the blocks are asked for as fast as they can be made
+    if (data.ahead != NULL) {
+        printf("Error: can't render to a file in render-ahead mode\n");
+        return 1;
+    }
+
+    memset(&info, 0, sizeof(info));
+    info.samplerate = SAMPLING_RATE;
+    info.channels = STEREO;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    outfile = sf_open(outFilename, SFM_WRITE, &info);
+    if (outfile == NULL) {
+        printf ("Error: could not open file: %s\n", outFilename) ;
+        puts(sf_strerror (NULL)) ;
+        return 1;
+    }
+
+    //nobody is there to press space, and edits sent since engine_init
+    //(files given to slices) count from the first block
+    spool_enter(data.files);
+    applyCommands();
+    spool_leave(data.files);
+    for (i = 0; i < data.slices.count; i++) {
+        data.slices.playing[i] = true;
+    }
+    //files the slices were moved to, and the first pages of streamed ones
+    spool_sync(data.files);
+    spool_enter(data.files);
+    wantSlices();
+    spool_leave(data.files);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    while (done < total) {
+        unsigned long frames = total - done < BUFFER_SIZE ? total - done : BUFFER_SIZE;
+        unsigned long long start;
+
+        //offline there is time to wait for the disk, so nothing misses
+        spool_sync(data.files);
+        start = stats_now();
+        engine_render(out, frames);
+        if (stats != NULL) {
+            stats_record(stats, start, 0, 0);
+        }
+        sf_writef_float(outfile, out, frames);
+        done += frames;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sf_close(outfile);
+
+    elapsed = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) * 1e-9;
+    printf("Rendered %.1f s of audio to %s in %.3f s (%.1fx real time)\n",
+            (double)total / SAMPLING_RATE, outFilename, elapsed,
+            elapsed > 0 ? total / (elapsed * SAMPLING_RATE) : 0.0);
+    engine_print_files();
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name: engine_send
+// Desc: queues an edit of a slice for the audio thread, returns 0 on success
+//-----------------------------------------------------------------------------
+int engine_send(commandType type, int slice, int amount){
+    command c;
+
+    c.type = type;
+    c.slice = slice;
+    c.amount = amount;
+    return rb_write(&data.commands, &c, 1) == 1 ? 0 : -1;
+}
+//-----------------------------------------------------------------------------
+// Name: applyCommands
+// Desc: drains the command queue into the slice table (audio thread)
+//-----------------------------------------------------------------------------
+static void applyCommands(){
+    command c;
+
+    while (rb_read(&data.commands, &c, 1) == 1) {
+        if (c.slice < 0 || c.slice >= data.slices.count) {
+            continue;
+        }
+        switch (c.type){
+            case CMD_STARTSTOP:     startstop(c.slice); break;
+            case CMD_MUTE:          muteSlice(c.slice); break;
+            case CMD_LOOP_LONGER:   increaseLoopLength(c.slice); break;
+            case CMD_LOOP_SHORTER:  decreaseLoopLength(c.slice); break;
+            case CMD_NUDGE:         nudgeLocation(c.slice, c.amount); break;
+            case CMD_VOLUME_UP:     volumeIncrease(c.slice); break;
+            case CMD_VOLUME_DOWN:   volumeDecrease(c.slice); break;
+            case CMD_LOWPASS_UP:    increaseLowpass(c.slice); break;
+            case CMD_LOWPASS_DOWN:  decreaseLowpass(c.slice); break;
+            case CMD_HIGHPASS_UP:   increaseHighpass(c.slice); break;
+            case CMD_HIGHPASS_DOWN: decreaseHighpass(c.slice); break;
+            case CMD_FILE:          setFile(c.slice, c.amount); break;
+        }
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: engine_publish
+// Desc: copies the slice table out for engine_state() (audio thread)
+//-----------------------------------------------------------------------------
+void engine_publish(){
+    //the render-ahead thread publishes after each block itself
+    if (data.ahead == NULL) {
+        publishState();
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: publishState
+// Desc: copies the slice table into the back state and swaps it in
+//-----------------------------------------------------------------------------
+static void publishState(){
+    sliceTable *t = &data.slices;
+    sliceState *st = &g_states[g_stateBack];
+    int n = t->count;
+    int i, j;
+
+    st->count = n;
+    memcpy(st->playing, t->playing, n * sizeof(bool));
+    memcpy(st->file, t->file, n * sizeof(int));
+    memcpy(st->start, t->start, n * sizeof(long long));
+    memcpy(st->loopLength, t->loopLength, n * sizeof(long long));
+    memcpy(st->volume, t->volume, n * sizeof(float));
+    for (i = 0; i < n; i++) {
+        st->lowpass[i] = t->slices[i].lowpass;
+        st->highpass[i] = t->slices[i].highpass;
+        //decimated waveform, same span the old full-buffer view covered
+        for (j = 0; j < WAVE_POINTS; j++) {
+            st->wave[i][j] = t->slices[i].buffer[j * (BUFFER_SIZE / WAVE_POINTS)];
+        }
+    }
+
+    g_stateBack = atomic_exchange(&g_stateMiddle, g_stateBack | STATE_FRESH) & ~STATE_FRESH;
+}
+//-----------------------------------------------------------------------------
+// Name: engine_state
+// Desc: latest published slice state (GUI)
+//-----------------------------------------------------------------------------
+const sliceState *engine_state(){
+    if (atomic_load(&g_stateMiddle) & STATE_FRESH) {
+        g_stateFront = atomic_exchange(&g_stateMiddle, g_stateFront) & ~STATE_FRESH;
+    }
+    return &g_states[g_stateFront];
+}
+//-----------------------------------------------------------------------------
+// Name: renderSlice
+// Desc: one slice's share of a block, on whichever thread of the pool
+//       picks it up: copy it out of its file in the pool (no disk access
+//       in here), then filter it if it is heard and has a cutoff in.
+//       touches nothing outside slice s
+//-----------------------------------------------------------------------------
+static void renderSlice(void *frames, int s) {
+    unsigned long n = *(unsigned long *)frames;
+    slice *sl = &data.slices.slices[s];
+
+    readSlice(s, n);
+    if (data.slices.volume[s] * data.slices.muter[s] != 0 && sl->filterOn) {
+        filterSlice(s, n);
+    }
+    else if (sl->filterLive) {
+        resetFilter(s);
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: filterSlice
+// Desc: runs a slice's buffer through its filters.  the biquads add no
+//       latency, the fft mask (engine_stft_filter) adds a window's worth
+//-----------------------------------------------------------------------------
+static void filterSlice(int s, unsigned long frames) {
+    slice *sl = &data.slices.slices[s];
+
+    sl->filterLive = true;
+    if (data.stft) {
+        filter(&sl->stft, sl->buffer, frames, sl->mask);
+    }
+    else {
+        biquad_process(&sl->eq, sl->buffer, frames);
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: resetFilter
+// Desc: a slice that went quiet or back to neutral drops its filter tail,
+//       so it doesn't come back with the end of what it played last time
+//-----------------------------------------------------------------------------
+static void resetFilter(int s) {
+    slice *sl = &data.slices.slices[s];
+
+    if (data.stft) {
+        stft_reset(&sl->stft);
+    }
+    else {
+        biquad_reset(&sl->eq);
+    }
+    sl->filterLive = false;
+}
+//-----------------------------------------------------------------------------
+// Name: setCutoffs
+// Desc: brings the filter in use in line with the slice's cutoffs, a
+//       cutoff at the edge of the audible range switches its half off.  the
+//       cutoffs are counted in steps so going back up lands on the edge
+//       exactly
+//-----------------------------------------------------------------------------
+static void setCutoffs(int s) {
+    slice *sl = &data.slices.slices[s];
+
+    sl->highpass = fminf(FILTER_MIN_HZ * powf(FILTER_STEP, sl->highpassSteps), FILTER_MAX_HZ);
+    sl->lowpass = fmaxf(FILTER_MAX_HZ / powf(FILTER_STEP, sl->lowpassSteps), FILTER_MIN_HZ);
+    if (data.stft) {
+        makeMask(s);
+    }
+    else {
+        biquad_set(&sl->eq, 0, sl->highpassSteps > 0 ? BIQUAD_HIGHPASS : BIQUAD_OFF,
+                   sl->highpass, BIQUAD_Q, 0);
+        biquad_set(&sl->eq, 1, sl->lowpassSteps > 0 ? BIQUAD_LOWPASS : BIQUAD_OFF,
+                   sl->lowpass, BIQUAD_Q, 0);
+    }
+    sl->filterOn = sl->highpassSteps > 0 || sl->lowpassSteps > 0;
+}
+//-----------------------------------------------------------------------------
+// Name: filter
+// Desc: Applies a slice's low pass and high pass mask to interleaved stereo,
+//       both channels through one complex fft per hop; the output is
+//       WINDOW_SIZE frames late.  touches nothing but its arguments so
+//       each slice can be filtered on its own thread
+//-----------------------------------------------------------------------------
+static void filter(stft_context *ctx, float *buffer, unsigned long frames, const float *mask) {
+    stft_stream_stereo(ctx, buffer, frames, maskStereo, (void *)mask);
+}
+//-----------------------------------------------------------------------------
+// Name: maskStereo
+// Desc: one hop's worth of filtering
+//-----------------------------------------------------------------------------
+static void maskStereo(stft_context *ctx, void *mask) {
+    maskSpectrum(ctx->left, mask);
+    maskSpectrum(ctx->right, mask);
+}
+//-----------------------------------------------------------------------------
+// Name: maskSpectrum
+// Desc: scales each bin by its gain, re and im alike so the phase is kept.
+//       the spectrum is packed like an rfft, nyquist sits in spectrum[1]
+//-----------------------------------------------------------------------------
+static void maskSpectrum(float *spectrum, const float *mask) {
+    int j;
+
+    spectrum[0] *= mask[0];
+    spectrum[1] *= mask[WINDOW_SIZE/2];
+    for (j = 1; j < WINDOW_SIZE/2; j++) {
+        spectrum[2*j] *= mask[j];
+        spectrum[2*j+1] *= mask[j];
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: makeMask
+// Desc: rebuilds a slice's filter mask from its cutoffs, the only place
+//       the stft filter calls sinf.  both edges fade over MASK_EDGE bins
+//       so moving a cutoff doesn't switch bins on and off between hops
+//-----------------------------------------------------------------------------
+static void makeMask(int s) {
+    slice *sl = &data.slices.slices[s];
+    float low = sl->highpass * WINDOW_SIZE / SAMPLING_RATE;
+    float high = sl->lowpass * WINDOW_SIZE / SAMPLING_RATE;
+    float gain;
+    int j;
+
+    for (j = 0; j < MASK_BINS; j++) {
+        gain = 1;
+        if (sl->highpassSteps > 0) {
+            gain *= maskEdge((j - low) / MASK_EDGE);
+        }
+        if (sl->lowpassSteps > 0) {
+            gain *= maskEdge((high - j) / MASK_EDGE);
+        }
+        sl->mask[j] = gain;
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: maskEdge
+// Desc: raised cosine from 0 at d = -1/2 to 1 at d = 1/2, half way at the
+//       cutoff itself
+//-----------------------------------------------------------------------------
+static float maskEdge(float d) {
+    if (d <= -0.5f) {
+        return 0;
+    }
+    if (d >= 0.5f) {
+        return 1;
+    }
+    return 0.5f + 0.5f * sinf(MASK_PI * d);
+}
+//-----------------------------------------------------------------------------
+// Name: startstop
+// Desc: toggles playback of the selected slice
+//-----------------------------------------------------------------------------
+static void startstop(int s){
+    data.slices.playing[s] = !data.slices.playing[s];
+}
+//-----------------------------------------------------------------------------
+// Name: increaseLoopLength
+// Desc: increases slice loop length
+//-----------------------------------------------------------------------------
+static void increaseLoopLength(int s)
+{
+    long long *loopLength = &data.slices.loopLength[s];
+
+    if (*loopLength < INC_LOOP_LENGTH){
+        *loopLength = *loopLength * 2;
+    }
+    else if (*loopLength < spool_frames(data.files, data.slices.file[s]) - INC_LOOP_LENGTH){//Only increase if loop length will be smaller than total audio
+        *loopLength += INC_LOOP_LENGTH;
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: decreaseLoopLength
+// Desc: decreases slice loop length
+//-----------------------------------------------------------------------------
+static void decreaseLoopLength(int s)
+{
+    long long *loopLength = &data.slices.loopLength[s];
+
+    if (*loopLength - INC_LOOP_LENGTH > 0){
+        *loopLength -= INC_LOOP_LENGTH;
+    }
+    else {
+        if (*loopLength/2 > 0){
+            *loopLength /= 2;
+        }
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: nudgeLocation
+// Desc: moves the slice start point within its file
+//-----------------------------------------------------------------------------
+static void nudgeLocation(int s, int nudgeAmount)
+{
+    long long *start = &data.slices.start[s];
+
+    if (*start + nudgeAmount > 0 &&
+        *start + nudgeAmount < spool_frames(data.files, data.slices.file[s])){
+        *start += nudgeAmount;
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: setFile
+// Desc: points a slice at another file in the pool. The start point keeps
+//       its place relative to the length of the file; a file that isn't
+//       loaded yet plays as silence until it is
+//-----------------------------------------------------------------------------
+static void setFile(int s, int file)
+{
+    sliceTable *t = &data.slices;
+    int old = t->file[s];
+    samplestore *store;
+    long long oldFrames;
+
+    if (file < 0 || file >= spool_count(data.files) || file == old) {
+        return;
+    }
+
+    //the old file's pager can let go of this slice's pages
+    store = spool_store(data.files, old);
+    if (store != NULL) {
+        store_want(store, s, 0, 0, 0);
+    }
+    spool_ref(data.files, file);
+    spool_unref(data.files, old);
+
+    //same place in the new file, proportionally; a file that decoded
+    //shorter than its header said can have come out empty
+    oldFrames = spool_frames(data.files, old);
+    t->start[s] = oldFrames > 0 ? (long long)((double)t->start[s] * spool_frames(data.files, file)
+                                              / oldFrames) : 0;
+    t->loopCounter[s] = 0;
+    t->file[s] = file;
+}
+//-----------------------------------------------------------------------------
+// Name: loopRegion
+// Desc: frames of a slice's loop actually backed by audio in a file of
+//       frames frames, a loop that runs past the end of the file wraps at
+//       the end of the file
+//-----------------------------------------------------------------------------
+static long long loopRegion(int s, long long frames)
+{
+    long long length = data.slices.loopLength[s];
+
+    if (length > frames - data.slices.start[s]) {
+        length = frames - data.slices.start[s];
+    }
+    return length;
+}
+//-----------------------------------------------------------------------------
+// Name: readSlice
+// Desc: copies the next block of a slice out of the store. The loop
+//       position is worked out per block: the copy is split at the exact
+//       frame where the loop wraps, so loop points are sample accurate
+//-----------------------------------------------------------------------------
+static void readSlice(int s, unsigned long frames)
+{
+    sliceTable *t = &data.slices;
+    float *buffer = t->slices[s].buffer;
+    samplestore *store = spool_store(data.files, t->file[s]);
+    long long length;
+    long long counter = t->loopCounter[s];
+    long done = 0, n;
+
+    //the length comes from the store read from, a file swapped for a
+    //shorter one can't be read past its end
+    if (store != NULL && store->frames > 0 && t->start[s] >= store->frames) {
+        t->start[s] %= store->frames;
+    }
+    length = loopRegion(s, store != NULL ? store->frames
+                                         : spool_frames(data.files, t->file[s]));
+
+    if (!t->playing[s] || length <= 0) {
+        //hold stopped slices at their start point
+        t->loopCounter[s] = 0;
+        t->muter[s] = 0.0;
+        return;
+    }
+    t->muter[s] = 1.0;
+
+    //loop was shortened past the play position
+    if (counter >= length) {
+        counter = 0;
+    }
+
+    //nothing will be heard, just move the position along
+    if (t->volume[s] == 0 || store == NULL) {
+        if (store == NULL) {
+            t->muter[s] = 0.0;
+        }
+        t->loopCounter[s] = (counter + frames) % length;
+        return;
+    }
+
+    while (done < (long)frames) {
+        n = frames - done;
+        if (n > length - counter) {
+            n = (long)(length - counter);
+        }
+
+        store_read_stereo(store, t->start[s] + counter, buffer + done * STEREO, n);
+        done += n;
+        counter += n;
+
+        //loop restart is just a new offset into the store
+        if (counter == length) {
+            counter = 0;
+        }
+    }
+    t->loopCounter[s] = counter;
+}
+//-----------------------------------------------------------------------------
+// Name: wantSlices
+// Desc: hands every slice's loop and play position to the pager of its
+//       file, stopped slices want the start of their loop.  no-op for
+//       files that aren't streamed
+//-----------------------------------------------------------------------------
+static void wantSlices(void)
+{
+    sliceTable *t = &data.slices;
+    samplestore *store;
+    int i;
+
+    for (i = 0; i < t->count; i++) {
+        store = spool_store(data.files, t->file[i]);
+        if (store != NULL) {
+            store_want(store, i, t->start[i], loopRegion(i, store->frames),
+                       t->start[i] + (t->playing[i] ? t->loopCounter[i] : 0));
+        }
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: muteSlice
+// Desc: Mute on/off for slices
+//-----------------------------------------------------------------------------
+static void muteSlice(int s)
+{
+    float *volume = &data.slices.volume[s];
+
+    if (*volume != 0){
+        *volume = 0;
+    }
+    else {
+        *volume = INIT_VOLUME;
+    }
+}
+//-----------------------------------------------------------------------------
+// Name: volumeIncrease (outputBuffer)
+// Desc: increase the volume
+//-----------------------------------------------------------------------------
+
+static void volumeIncrease(int s)
+
+{
+    float *volume = &data.slices.volume[s];
+
+    if (*volume != 1){
+        *volume += VOLUME_INCR;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: volumeDecrease (outputBuffer)
+// Desc: decrease the volume
+//-----------------------------------------------------------------------------
+
+static void volumeDecrease(int s)
+
+{
+    float *volume = &data.slices.volume[s];
+
+    if (*volume != 0){
+        *volume -= VOLUME_INCR;
+    }
+}
+
+static void decreaseLowpass(int i){
+    slice *s = &data.slices.slices[i];
+
+    if (s->lowpassSteps < FILTER_STEPS) {
+        s->lowpassSteps++;
+    }
+    setCutoffs(i);
+}
+static void increaseLowpass(int i){
+    slice *s = &data.slices.slices[i];
+
+    if (s->lowpassSteps > 0) {
+        s->lowpassSteps--;
+    }
+    setCutoffs(i);
+}
+
+static void decreaseHighpass(int i)
+{
+    slice *s = &data.slices.slices[i];
+
+    if (s->highpassSteps > 0) {
+        s->highpassSteps--;
+    }
+    setCutoffs(i);
+}
+
+static void increaseHighpass(int i)
+{
+    slice *s = &data.slices.slices[i];
+
+    if (s->highpassSteps < FILTER_STEPS) {
+        s->highpassSteps++;
+    }
+    setCutoffs(i);
+}
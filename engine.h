@@ -0,0 +1,119 @@
+//-----------------------------------------------------------------------------
+// name: engine.h
+// desc: slice sampler audio engine - sample store, slices, mixer and filter
+//
+//   no windowing or audio device code lives behind this header.  one thread
+//   (the audio callback or an offline loop) calls engine_render(); one other
+//   thread may edit slices with engine_send() and watch them through
+//   engine_state().
+//-----------------------------------------------------------------------------
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "stats.h"
+
+
+#define BUFFER_SIZE             2048
+#define SAMPLING_RATE           44100
+#define STEREO                  2
+#define MAX_SLICES              64
+#define DEFAULT_SLICES          4
+#define WAVE_POINTS             512//waveform points per slice in sliceState
+#define DEFAULT_RENDER_SECONDS  10
+
+//edits applied by the audio thread at the start of a block
+typedef enum {
+    CMD_STARTSTOP,
+    CMD_MUTE,
+    CMD_LOOP_LONGER,
+    CMD_LOOP_SHORTER,
+    CMD_NUDGE,
+    CMD_VOLUME_UP,
+    CMD_VOLUME_DOWN,
+    CMD_LOWPASS_UP,
+    CMD_LOWPASS_DOWN,
+    CMD_HIGHPASS_UP,
+    CMD_HIGHPASS_DOWN,
+    CMD_FILE                //amount is the index engine_add_file() returned
+} commandType;
+
+//copy of the slice table published after every block
+typedef struct {
+    int count;
+    bool playing[MAX_SLICES];
+    int file[MAX_SLICES];
+    long long start[MAX_SLICES];
+    long long loopLength[MAX_SLICES];
+    float volume[MAX_SLICES];
+    float lowpass[MAX_SLICES];
+    float highpass[MAX_SLICES];
+    float wave[MAX_SLICES][WAVE_POINTS];
+} sliceState;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// bytes of decoded audio the engine may keep in memory: files nobody plays
+// are dropped past it and a longer file is streamed from disk; 0 for the
+// default.  call before engine_init()
+void engine_memory_budget( size_t bytes );
+// keep 16 and 24-bit files as packed integers instead of float, the same
+// audio in half or three quarters the memory.  call before engine_init()
+void engine_compact_samples( bool on );
+// filter slices with an fft mask instead of biquads: steeper cutoffs, but
+// a quarter of a block of latency.  call before engine_init()
+void engine_stft_filter( bool on );
+// directory decoded files are cached in so later loads map them instead of
+// decoding: NULL for $XDG_CACHE_HOME/slicesampler, "" to cache nothing.
+// call before engine_init()
+void engine_cache_dir( const char * dir );
+// load a file and spread numSlices slices across it, returns 0 on success
+int engine_init( const char * audioFilename, int numSlices );
+void engine_free( void );
+
+// control thread: add a file for slices to play, loaded in the background.
+// returns its index for CMD_FILE, or -1 if it can't be opened; adding a
+// file twice returns the same index
+int engine_add_file( const char * audioFilename );
+// control thread: load another file in the background and swap it in for
+// file between two blocks, without the audio thread waiting; returns 0 if
+// the load is queued
+int engine_replace_file( int file, const char * audioFilename );
+// control thread: print every file with its sample format and the bytes
+// of it in memory
+void engine_print_files( void );
+// files added so far, the one engine_init() loaded is 0
+int engine_file_count( void );
+const char * engine_file_name( int file );
+
+// audio thread: render frames (<= BUFFER_SIZE) of interleaved stereo
+void engine_render( float * out, unsigned long frames );
+// audio thread: make the current slice table visible to engine_state()
+void engine_publish( void );
+
+// render each block a block early on a thread of its own, so rendering
+// gets a whole buffer period; call after engine_init, before the first
+// engine_render.  returns 0 on success
+int engine_render_ahead( void );
+// blocks render-ahead didn't have ready in time and played as silence
+unsigned long long engine_missed_blocks( void );
+
+// control thread: queue an edit, returns -1 if the queue is full
+int engine_send( commandType type, int slice, int amount );
+// control thread: latest published slice table
+const sliceState * engine_state( void );
+
+// render seconds of audio with every slice playing, no audio device needed;
+// each block is timed into stats if it is not NULL
+int engine_render_file( const char * outFilename, double seconds, callbackStats * stats );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
@@ -1,282 +1,1510 @@
-//-----------------------------------------------------------------------------
-// name: fft.c
-// desc: fft impl - based on CARL distribution
-//
-// authors: code from San Diego CARL package
-//          Ge Wang (gewang@cs.princeton.edu)
-//          Perry R. Cook (prc@cs.princeton.edu)
-// date: 11.27.2003
-//-----------------------------------------------------------------------------
-#include "fft.h"
-#include <stdlib.h>
-#include <math.h>
-
-
-
-
-//-----------------------------------------------------------------------------
-// name: hanning()
-// desc: make window
-//-----------------------------------------------------------------------------
-void hanning( float * window, unsigned long length )
-{
-   unsigned long i;
-   double pi, phase = 0, delta;
-
-   pi = 4.*atan(1.0);
-   delta = 2 * pi / (double) length;
-
-   for( i = 0; i < length; i++ )
-   {
-       window[i] = (float)(0.5 * (1.0 - cos(phase)));
-       phase += delta;
-   }
-}
-
-
-
-
-//-----------------------------------------------------------------------------
-// name: hamming()
-// desc: make window
-//-----------------------------------------------------------------------------
-void hamming( float * window, unsigned long length )
-{
-    unsigned long i;
-    double pi, phase = 0, delta;
-
-    pi = 4.*atan(1.0);
-    delta = 2 * pi / (double) length;
-
-    for( i = 0; i < length; i++ )
-    {
-        window[i] = (float)(0.54 - .46*cos(phase));
-        phase += delta;
-    }
-}
-
-
-
-//-----------------------------------------------------------------------------
-// name: blackman()
-// desc: make window
-//-----------------------------------------------------------------------------
-void blackman( float * window, unsigned long length )
-{
-    unsigned long i;
-    double pi, phase = 0, delta;
-
-    pi = 4.*atan(1.0);
-    delta = 2 * pi / (double) length;
-
-    for( i = 0; i < length; i++ )
-    {
-        window[i] = (float)(0.42 - .5*cos(phase) + .08*cos(2*phase));
-        phase += delta;
-    }
-}
-
-
-
-
-//-----------------------------------------------------------------------------
-// name: apply_window()
-// desc: apply a window to data
-//-----------------------------------------------------------------------------
-void apply_window( float * data, float * window, unsigned long length )
-{
-   unsigned long i;
-
-   for( i = 0; i < length; i++ )
-       data[i] *= window[i];
-}
-
-static float PI ;
-static float TWOPI ;
-void bit_reverse( float * x, long N );
-
-
-//-----------------------------------------------------------------------------
-// name: rfft()
-// desc: real value fft
-//
-//   these routines from the CARL software, spect.c
-//   check out the CARL CMusic distribution for more source code
-//
-//   if forward is true, rfft replaces 2*N real data points in x with N complex 
-//   values representing the positive frequency half of their Fourier spectrum,
-//   with x[1] replaced with the real part of the Nyquist frequency value.
-//
-//   if forward is false, rfft expects x to contain a positive frequency 
-//   spectrum arranged as before, and replaces it with 2*N real values.
-//
-//   N MUST be a power of 2.
-//
-//-----------------------------------------------------------------------------
-void rfft( float * x, long N, unsigned int forward )
-{
-    static int first = 1 ;
-    //filter coefficientss
-    float c1, c2, h1r, h1i, h2r, h2i, wr, wi, wpr, wpi, temp, theta ;
-    float xr, xi ;
-    long i, i1, i2, i3, i4, N2p1 ;
-
-    if( first )
-    {
-        PI = (float) (4.*atan( 1. )) ;
-        TWOPI = (float) (8.*atan( 1. )) ;
-        first = 0 ;
-    }
-
-    theta = PI/N ;
-    wr = 1. ;
-    wi = 0. ;
-    c1 = 0.5 ;
-
-    if( forward )
-    {
-        c2 = -0.5 ;
-        cfft( x, N, forward ) ;
-        xr = x[0] ;
-        xi = x[1] ;
-    }
-    else
-    {
-        c2 = 0.5 ;
-        theta = -theta ;
-        xr = x[1] ;
-        xi = 0. ;
-        x[1] = 0. ;
-    }
-    
-    wpr = (float) (-2.*pow( sin( 0.5*theta ), 2. )) ;
-    wpi = (float) sin( theta ) ;
-    N2p1 = (N<<1) + 1 ;
-    
-    for( i = 0 ; i <= N>>1 ; i++ )
-    {
-        i1 = i<<1 ;
-        i2 = i1 + 1 ;
-        i3 = N2p1 - i2 ;
-        i4 = i3 + 1 ;
-        if( i == 0 )
-        {
-            h1r =  c1*(x[i1] + xr ) ;
-            h1i =  c1*(x[i2] - xi ) ;
-            h2r = -c2*(x[i2] + xi ) ;
-            h2i =  c2*(x[i1] - xr ) ;
-            x[i1] =  h1r + wr*h2r - wi*h2i ;
-            x[i2] =  h1i + wr*h2i + wi*h2r ;
-            xr =  h1r - wr*h2r + wi*h2i ;
-            xi = -h1i + wr*h2i + wi*h2r ;
-        }
-        else
-        {
-            h1r =  c1*(x[i1] + x[i3] ) ;
-            h1i =  c1*(x[i2] - x[i4] ) ;
-            h2r = -c2*(x[i2] + x[i4] ) ;
-            h2i =  c2*(x[i1] - x[i3] ) ;
-            x[i1] =  h1r + wr*h2r - wi*h2i ;
-            x[i2] =  h1i + wr*h2i + wi*h2r ;
-            x[i3] =  h1r - wr*h2r + wi*h2i ;
-            x[i4] = -h1i + wr*h2i + wi*h2r ;
-        }
-
-        wr = (temp = wr)*wpr - wi*wpi + wr ;
-        wi = wi*wpr + temp*wpi + wi ;
-    }
-
-    if( forward )
-        x[1] = xr ;
-    else
-        cfft( x, N, forward ) ;
-}
-
-
-
-
-//-----------------------------------------------------------------------------
-// name: cfft()
-// desc: complex value fft
-//
-//   these routines from CARL software, spect.c
-//   check out the CARL CMusic distribution for more software
-//
-//   cfft replaces float array x containing NC complex values (2*NC float 
-//   values alternating real, imagininary, etc.) by its Fourier transform 
-//   if forward is true, or by its inverse Fourier transform ifforward is 
-//   false, using a recursive Fast Fourier transform method due to 
-//   Danielson and Lanczos.
-//
-//   NC MUST be a power of 2.
-//
-//-----------------------------------------------------------------------------
-void cfft( float * x, long NC, unsigned int forward )
-{
-    float wr, wi, wpr, wpi, theta, scale ;
-    long mmax, ND, m, i, j, delta ;
-    ND = NC<<1 ;
-    bit_reverse( x, ND ) ;
-    
-    for( mmax = 2 ; mmax < ND ; mmax = delta )
-    {
-        delta = mmax<<1 ;
-        theta = TWOPI/( forward? mmax : -mmax ) ;
-        wpr = (float) (-2.*pow( sin( 0.5*theta ), 2. )) ;
-        wpi = (float) sin( theta ) ;
-        wr = 1. ;
-        wi = 0. ;
-
-        for( m = 0 ; m < mmax ; m += 2 )
-        {
-            register float rtemp, itemp ;
-            for( i = m ; i < ND ; i += delta )
-            {
-                j = i + mmax ;
-                rtemp = wr*x[j] - wi*x[j+1] ;
-                itemp = wr*x[j+1] + wi*x[j] ;
-                x[j] = x[i] - rtemp ;
-                x[j+1] = x[i+1] - itemp ;
-                x[i] += rtemp ;
-                x[i+1] += itemp ;
-            }
-
-            wr = (rtemp = wr)*wpr - wi*wpi + wr ;
-            wi = wi*wpr + rtemp*wpi + wi ;
-        }
-    }
-
-    // scale output
-    scale = (float)(forward ? 1./ND : 2.) ;
-    {
-        register float *xi=x, *xe=x+ND ;
-        while( xi < xe )
-            *xi++ *= scale ;
-    }
-}
-
-
-
-
-//-----------------------------------------------------------------------------
-// name: bit_reverse()
-// desc: bitreverse places float array x containing N/2 complex values
-//       into bit-reversed order
-//-----------------------------------------------------------------------------
-void bit_reverse( float * x, long N )
-{
-    float rtemp, itemp ;
-    long i, j, m ;
-    for( i = j = 0 ; i < N ; i += 2, j += m )
-    {
-        if( j > i )
-        {
-            rtemp = x[j] ; itemp = x[j+1] ; /* complex exchange */
-            x[j] = x[i] ; x[j+1] = x[i+1] ;
-            x[i] = rtemp ; x[i+1] = itemp ;
-        }
-
-        for( m = N>>1 ; m >= 2 && j >= m ; m >>= 1 )
-            j -= m ;
-    }
-}
+//-----------------------------------------------------------------------------
+// name: fft.c
+// desc: fft impl - based on CARL distribution
+//
+// authors: code from San Diego CARL package
+//          Ge Wang (gewang@cs.princeton.edu)
+//          Perry R. Cook (prc@cs.princeton.edu)
+// date: 11.27.2003
+//-----------------------------------------------------------------------------
+#include "fft.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+  #define FFT_X86 1
+  #include <immintrin.h>
+#endif
+
+
+#define FFT_PI      3.14159265358979323846
+#define FFT_TWOPI   6.28318530717958647692
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: hanning()
+// desc: make window
+//-----------------------------------------------------------------------------
+void hanning( float * window, unsigned long length )
+{
+   unsigned long i;
+   double pi, phase = 0, delta;
+
+   pi = 4.*atan(1.0);
+   delta = 2 * pi / (double) length;
+
+   for( i = 0; i < length; i++ )
+   {
+       window[i] = (float)(0.5 * (1.0 - cos(phase)));
+       phase += delta;
+   }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: hamming()
+// desc: make window
+//-----------------------------------------------------------------------------
+void hamming( float * window, unsigned long length )
+{
+    unsigned long i;
+    double pi, phase = 0, delta;
+
+    pi = 4.*atan(1.0);
+    delta = 2 * pi / (double) length;
+
+    for( i = 0; i < length; i++ )
+    {
+        window[i] = (float)(0.54 - .46*cos(phase));
+        phase += delta;
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+// name: blackman()
+// desc: make window
+//-----------------------------------------------------------------------------
+void blackman( float * window, unsigned long length )
+{
+    unsigned long i;
+    double pi, phase = 0, delta;
+
+    pi = 4.*atan(1.0);
+    delta = 2 * pi / (double) length;
+
+    for( i = 0; i < length; i++ )
+    {
+        window[i] = (float)(0.42 - .5*cos(phase) + .08*cos(2*phase));
+        phase += delta;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: apply_window()
+// desc: apply a window to data
+//-----------------------------------------------------------------------------
+void apply_window( float * data, float * window, unsigned long length )
+{
+   unsigned long i;
+
+   for( i = 0; i < length; i++ )
+       data[i] *= window[i];
+}
+
+static void bit_reverse( float * x, long N );
+
+
+//-----------------------------------------------------------------------------
+// name: rfft()
+// desc: real value fft
+//
+//   these routines from the CARL software, spect.c
+//   check out the CARL CMusic distribution for more source code
+//
+//   if forward is true, rfft replaces 2*N real data points in x with N complex 
+//   values representing the positive frequency half of their Fourier spectrum,
+//   with x[1] replaced with the real part of the Nyquist frequency value.
+//
+//   if forward is false, rfft expects x to contain a positive frequency 
+//   spectrum arranged as before, and replaces it with 2*N real values.
+//
+//   N MUST be a power of 2.
+//
+//-----------------------------------------------------------------------------
+void rfft( float * x, long N, unsigned int forward )
+{
+    //filter coefficientss
+    float c1, c2, h1r, h1i, h2r, h2i, wr, wi, wpr, wpi, temp, theta ;
+    float xr, xi ;
+    long i, i1, i2, i3, i4, N2p1 ;
+
+    theta = (float)(FFT_PI/N) ;
+    wr = 1. ;
+    wi = 0. ;
+    c1 = 0.5 ;
+
+    if( forward )
+    {
+        c2 = -0.5 ;
+        cfft( x, N, forward ) ;
+        xr = x[0] ;
+        xi = x[1] ;
+    }
+    else
+    {
+        c2 = 0.5 ;
+        theta = -theta ;
+        xr = x[1] ;
+        xi = 0. ;
+        x[1] = 0. ;
+    }
+    
+    wpr = (float) (-2.*pow( sin( 0.5*theta ), 2. )) ;
+    wpi = (float) sin( theta ) ;
+    N2p1 = (N<<1) + 1 ;
+    
+    for( i = 0 ; i <= N>>1 ; i++ )
+    {
+        i1 = i<<1 ;
+        i2 = i1 + 1 ;
+        i3 = N2p1 - i2 ;
+        i4 = i3 + 1 ;
+        if( i == 0 )
+        {
+            h1r =  c1*(x[i1] + xr ) ;
+            h1i =  c1*(x[i2] - xi ) ;
+            h2r = -c2*(x[i2] + xi ) ;
+            h2i =  c2*(x[i1] - xr ) ;
+            x[i1] =  h1r + wr*h2r - wi*h2i ;
+            x[i2] =  h1i + wr*h2i + wi*h2r ;
+            xr =  h1r - wr*h2r + wi*h2i ;
+            xi = -h1i + wr*h2i + wi*h2r ;
+        }
+        else
+        {
+            h1r =  c1*(x[i1] + x[i3] ) ;
+            h1i =  c1*(x[i2] - x[i4] ) ;
+            h2r = -c2*(x[i2] + x[i4] ) ;
+            h2i =  c2*(x[i1] - x[i3] ) ;
+            x[i1] =  h1r + wr*h2r - wi*h2i ;
+            x[i2] =  h1i + wr*h2i + wi*h2r ;
+            x[i3] =  h1r - wr*h2r + wi*h2i ;
+            x[i4] = -h1i + wr*h2i + wi*h2r ;
+        }
+
+        wr = (temp = wr)*wpr - wi*wpi + wr ;
+        wi = wi*wpr + temp*wpi + wi ;
+    }
+
+    if( forward )
+        x[1] = xr ;
+    else
+        cfft( x, N, forward ) ;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cfft()
+// desc: complex value fft
+//
+//   these routines from CARL software, spect.c
+//   check out the CARL CMusic distribution for more software
+//
+//   cfft replaces float array x containing NC complex values (2*NC float 
+//   values alternating real, imagininary, etc.) by its Fourier transform 
+//   if forward is true, or by its inverse Fourier transform ifforward is 
+//   false, using a recursive Fast Fourier transform method due to 
+//   Danielson and Lanczos.
+//
+//   NC MUST be a power of 2.
+//
+//-----------------------------------------------------------------------------
+void cfft( float * x, long NC, unsigned int forward )
+{
+    float wr, wi, wpr, wpi, theta, scale ;
+    long mmax, ND, m, i, j, delta ;
+    ND = NC<<1 ;
+    bit_reverse( x, ND ) ;
+    
+    for( mmax = 2 ; mmax < ND ; mmax = delta )
+    {
+        delta = mmax<<1 ;
+        theta = (float)(FFT_TWOPI/( forward? mmax : -mmax )) ;
+        wpr = (float) (-2.*pow( sin( 0.5*theta ), 2. )) ;
+        wpi = (float) sin( theta ) ;
+        wr = 1. ;
+        wi = 0. ;
+
+        for( m = 0 ; m < mmax ; m += 2 )
+        {
+            register float rtemp, itemp ;
+            for( i = m ; i < ND ; i += delta )
+            {
+                j = i + mmax ;
+                rtemp = wr*x[j] - wi*x[j+1] ;
+                itemp = wr*x[j+1] + wi*x[j] ;
+                x[j] = x[i] - rtemp ;
+                x[j+1] = x[i+1] - itemp ;
+                x[i] += rtemp ;
+                x[i+1] += itemp ;
+            }
+
+            wr = (rtemp = wr)*wpr - wi*wpi + wr ;
+            wi = wi*wpr + rtemp*wpi + wi ;
+        }
+    }
+
+    // scale output
+    scale = (float)(forward ? 1./ND : 2.) ;
+    {
+        register float *xi=x, *xe=x+ND ;
+        while( xi < xe )
+            *xi++ *= scale ;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: bit_reverse()
+// desc: bitreverse places float array x containing N/2 complex values
+//       into bit-reversed order
+//-----------------------------------------------------------------------------
+static void bit_reverse( float * x, long N )
+{
+    float rtemp, itemp ;
+    long i, j, m ;
+    for( i = j = 0 ; i < N ; i += 2, j += m )
+    {
+        if( j > i )
+        {
+            rtemp = x[j] ; itemp = x[j+1] ; /* complex exchange */
+            x[j] = x[i] ; x[j+1] = x[i+1] ;
+            x[i] = rtemp ; x[i+1] = itemp ;
+        }
+
+        for( m = N>>1 ; m >= 2 && j >= m ; m >>= 1 )
+            j -= m ;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_radix2()
+// desc: first pass when log2(N) is odd, so the radix-4 passes pair up;
+//       every twiddle is 1
+//-----------------------------------------------------------------------------
+static inline void fft_radix2( float * x, long N )
+{
+    float ar, ai, br, bi;
+    long g;
+
+    for( g = 0; g < N<<1; g += 4 )
+    {
+        ar = x[g]; ai = x[g+1]; br = x[g+2]; bi = x[g+3];
+        x[g] = ar + br; x[g+1] = ai + bi;
+        x[g+2] = ar - br; x[g+3] = ai - bi;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_pass4()
+// desc: one radix-4 pass, the two radix-2 passes of half size h and 2h at
+//       once.  with b, d scaled by w1 = exp(i*pi*k/h) and the second
+//       level by w2 = exp(i*pi*k/2h), the k+h output picks up an extra
+//       factor of i (-i inverse).
+//-----------------------------------------------------------------------------
+static inline void fft_pass4( const fft_plan * plan, float * x, long h, float sign )
+{
+    const float * r1 = plan->twiddleRe + 2*(h-1), * i1 = plan->twiddleIm + 2*(h-1);
+    const float * r2 = plan->twiddleRe + 2*(2*h-1), * i2 = plan->twiddleIm + 2*(2*h-1);
+    float w1r, w1i, w2r, w2i, tr, ti, a1r, a1i, b1r, b1i, c1r, c1i, d1r, d1i;
+    long g, k;
+
+    for( g = 0; g < plan->N<<1; g += 8*h )
+    {
+        float * a = x + g, * b = a + 2*h, * c = b + 2*h, * d = c + 2*h;
+
+        for( k = 0; k < 2*h; k += 2 )
+        {
+            w1r = r1[k]; w1i = sign * i1[k+1];
+            w2r = r2[k]; w2i = sign * i2[k+1];
+
+            tr = w1r*b[k] - w1i*b[k+1]; ti = w1r*b[k+1] + w1i*b[k];
+            a1r = a[k] + tr; a1i = a[k+1] + ti;
+            b1r = a[k] - tr; b1i = a[k+1] - ti;
+            tr = w1r*d[k] - w1i*d[k+1]; ti = w1r*d[k+1] + w1i*d[k];
+            c1r = c[k] + tr; c1i = c[k+1] + ti;
+            d1r = c[k] - tr; d1i = c[k+1] - ti;
+
+            tr = w2r*c1r - w2i*c1i; ti = w2r*c1i + w2i*c1r;
+            a[k] = a1r + tr; a[k+1] = a1i + ti;
+            c[k] = a1r - tr; c[k+1] = a1i - ti;
+            // times +-i
+            tr = -sign * (w2r*d1i + w2i*d1r); ti = sign * (w2r*d1r - w2i*d1i);
+            b[k] = b1r + tr; b[k+1] = b1i + ti;
+            d[k] = b1r - tr; d[k+1] = b1i - ti;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_scalar()
+// desc: plain C kernel
+//-----------------------------------------------------------------------------
+static void fft_scalar( const fft_plan * plan, float * x, unsigned int forward )
+{
+    float sign = forward ? 1.f : -1.f;
+    long h = 1;
+
+    if( __builtin_ctzl( plan->N ) & 1 )
+    {
+        fft_radix2( x, plan->N );
+        h = 2;
+    }
+    for( ; h < plan->N; h <<= 2 )
+        fft_pass4( plan, x, h, sign );
+}
+
+
+
+
+#ifdef FFT_X86
+//-----------------------------------------------------------------------------
+// name: fft_pass4_sse()
+// desc: fft_pass4() two complex values at a time, h >= 2; inlined into
+//       the avx kernel as well for its h == 2 pass
+//-----------------------------------------------------------------------------
+__attribute__(( target( "sse2" ), always_inline ))
+static inline void fft_pass4_sse( const fft_plan * plan, float * x, long h,
+                                  __m128 wsign, __m128 rot )
+{
+    const float * r1 = plan->twiddleRe + 2*(h-1), * i1 = plan->twiddleIm + 2*(h-1);
+    const float * r2 = plan->twiddleRe + 2*(2*h-1), * i2 = plan->twiddleIm + 2*(2*h-1);
+    long g, k;
+
+    // x * w with w as (wr, wr) and (-wi, wi): x*wr + swap(x)*wi
+    #define CMUL_SSE( v, wr, wi ) _mm_add_ps( _mm_mul_ps( v, wr ), \
+        _mm_mul_ps( _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 3, 0, 1 ) ), wi ) )
+
+    for( g = 0; g < plan->N<<1; g += 8*h )
+    {
+        float * a = x + g, * b = a + 2*h, * c = b + 2*h, * d = c + 2*h;
+
+        for( k = 0; k < 2*h; k += 4 )
+        {
+            __m128 w1r = _mm_loadu_ps( r1 + k ), w1i = _mm_xor_ps( _mm_loadu_ps( i1 + k ), wsign );
+            __m128 w2r = _mm_loadu_ps( r2 + k ), w2i = _mm_xor_ps( _mm_loadu_ps( i2 + k ), wsign );
+            __m128 va = _mm_loadu_ps( a + k ), vc = _mm_loadu_ps( c + k );
+            __m128 vb = CMUL_SSE( _mm_loadu_ps( b + k ), w1r, w1i );
+            __m128 vd = CMUL_SSE( _mm_loadu_ps( d + k ), w1r, w1i );
+            __m128 a1 = _mm_add_ps( va, vb ), b1 = _mm_sub_ps( va, vb );
+            __m128 c1 = _mm_add_ps( vc, vd ), d1 = _mm_sub_ps( vc, vd );
+
+            c1 = CMUL_SSE( c1, w2r, w2i );
+            d1 = CMUL_SSE( d1, w2r, w2i );
+            d1 = _mm_xor_ps( _mm_shuffle_ps( d1, d1, _MM_SHUFFLE( 2, 3, 0, 1 ) ), rot );
+
+            _mm_storeu_ps( a + k, _mm_add_ps( a1, c1 ) );
+            _mm_storeu_ps( c + k, _mm_sub_ps( a1, c1 ) );
+            _mm_storeu_ps( b + k, _mm_add_ps( b1, d1 ) );
+            _mm_storeu_ps( d + k, _mm_sub_ps( b1, d1 ) );
+        }
+    }
+
+    #undef CMUL_SSE
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_sse2()
+// desc: ...
+//-----------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+static void fft_sse2( const fft_plan * plan, float * x, unsigned int forward )
+{
+    float sign = forward ? 1.f : -1.f;
+    // inverse flips the twiddle sines; times i is (-im, re), times -i (im, -re)
+    __m128 wsign = _mm_set1_ps( forward ? 0.f : -0.f );
+    __m128 rot = forward ? _mm_set_ps( 0.f, -0.f, 0.f, -0.f ) : _mm_set_ps( -0.f, 0.f, -0.f, 0.f );
+    long h = 1;
+
+    if( __builtin_ctzl( plan->N ) & 1 )
+    {
+        fft_radix2( x, plan->N );
+        h = 2;
+    }
+    else if( h < plan->N )
+    {
+        fft_pass4( plan, x, h, sign );
+        h = 4;
+    }
+    for( ; h < plan->N; h <<= 2 )
+        fft_pass4_sse( plan, x, h, wsign, rot );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_avx2()
+// desc: four complex values at a time with fused multiply-add, h >= 4
+//-----------------------------------------------------------------------------
+__attribute__(( target( "avx2,fma" ) ))
+static void fft_avx2( const fft_plan * plan, float * x, unsigned int forward )
+{
+    float sign = forward ? 1.f : -1.f;
+    __m128 wsign4 = _mm_set1_ps( forward ? 0.f : -0.f );
+    __m128 rot4 = forward ? _mm_set_ps( 0.f, -0.f, 0.f, -0.f ) : _mm_set_ps( -0.f, 0.f, -0.f, 0.f );
+    __m256 wsign = _mm256_set1_ps( forward ? 0.f : -0.f );
+    __m256 rot = _mm256_set_m128( rot4, rot4 );
+    long h = 1, g, k;
+
+    #define CMUL_AVX( v, wr, wi ) _mm256_fmadd_ps( v, wr, \
+        _mm256_mul_ps( _mm256_permute_ps( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ), wi ) )
+
+    if( __builtin_ctzl( plan->N ) & 1 )
+    {
+        fft_radix2( x, plan->N );
+        h = 2;
+    }
+    else if( h < plan->N )
+    {
+        fft_pass4( plan, x, h, sign );
+        h = 4;
+    }
+    if( h == 2 && h < plan->N )
+    {
+        fft_pass4_sse( plan, x, h, wsign4, rot4 );
+        h = 8;
+    }
+
+    for( ; h < plan->N; h <<= 2 )
+    {
+        const float * r1 = plan->twiddleRe + 2*(h-1), * i1 = plan->twiddleIm + 2*(h-1);
+        const float * r2 = plan->twiddleRe + 2*(2*h-1), * i2 = plan->twiddleIm + 2*(2*h-1);
+
+        for( g = 0; g < plan->N<<1; g += 8*h )
+        {
+            float * a = x + g, * b = a + 2*h, * c = b + 2*h, * d = c + 2*h;
+
+            for( k = 0; k < 2*h; k += 8 )
+            {
+                __m256 w1r = _mm256_loadu_ps( r1 + k ), w1i = _mm256_xor_ps( _mm256_loadu_ps( i1 + k ), wsign );
+                __m256 w2r = _mm256_loadu_ps( r2 + k ), w2i = _mm256_xor_ps( _mm256_loadu_ps( i2 + k ), wsign );
+                __m256 va = _mm256_loadu_ps( a + k ), vc = _mm256_loadu_ps( c + k );
+                __m256 vb = CMUL_AVX( _mm256_loadu_ps( b + k ), w1r, w1i );
+                __m256 vd = CMUL_AVX( _mm256_loadu_ps( d + k ), w1r, w1i );
+                __m256 a1 = _mm256_add_ps( va, vb ), b1 = _mm256_sub_ps( va, vb );
+                __m256 c1 = _mm256_add_ps( vc, vd ), d1 = _mm256_sub_ps( vc, vd );
+
+                c1 = CMUL_AVX( c1, w2r, w2i );
+                d1 = CMUL_AVX( d1, w2r, w2i );
+                d1 = _mm256_xor_ps( _mm256_permute_ps( d1, _MM_SHUFFLE( 2, 3, 0, 1 ) ), rot );
+
+                _mm256_storeu_ps( a + k, _mm256_add_ps( a1, c1 ) );
+                _mm256_storeu_ps( c + k, _mm256_sub_ps( a1, c1 ) );
+                _mm256_storeu_ps( b + k, _mm256_add_ps( b1, d1 ) );
+                _mm256_storeu_ps( d + k, _mm256_sub_ps( b1, d1 ) );
+            }
+        }
+    }
+
+    #undef CMUL_AVX
+
+    // avoid the AVX/SSE transition penalty in whatever runs next
+    _mm256_zeroupper();
+}
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_radix2()
+// desc: fft_radix2() on lanes f0..K of a batch
+//
+//   batches are transposed: value i of frame f lives at x[i*K + f], so
+//   complex point p of every frame is K real parts then K imaginary parts
+//   and the lanes of a vector are K different frames going through the
+//   same butterfly.
+//-----------------------------------------------------------------------------
+static inline void batch_radix2( float * x, long N, long K, long f0 )
+{
+    float ar, ai, br, bi;
+    long g, f;
+
+    for( g = 0; g < N; g += 2 )
+    {
+        float * a = x + 2*g*K, * b = a + 2*K;
+
+        for( f = f0; f < K; f++ )
+        {
+            ar = a[f]; ai = a[K+f]; br = b[f]; bi = b[K+f];
+            a[f] = ar + br; a[K+f] = ai + bi;
+            b[f] = ar - br; b[K+f] = ai - bi;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_reverse()
+// desc: bit-reversal exchanges on lanes f0..K of a batch
+//-----------------------------------------------------------------------------
+static inline void batch_reverse( const fft_plan * plan, float * x, long K, long f0 )
+{
+    const long * sw = plan->swaps;
+    float temp;
+    long k, f;
+
+    for( k = 0; k < plan->numSwaps; k++ )
+    {
+        float * a = x + sw[2*k]*K, * b = x + sw[2*k+1]*K;
+
+        for( f = f0; f < K; f++ )
+        {
+            temp = a[f]; a[f] = b[f]; b[f] = temp;
+            temp = a[K+f]; a[K+f] = b[K+f]; b[K+f] = temp;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_pass4()
+// desc: fft_pass4() on lanes f0..K of a batch
+//-----------------------------------------------------------------------------
+static inline void batch_pass4( const fft_plan * plan, float * x, long K,
+                                long h, float sign, long f0 )
+{
+    float w1r, w1i, w2r, w2i, tr, ti, a1r, a1i, b1r, b1i, c1r, c1i, d1r, d1i;
+    long g, k, f;
+
+    for( g = 0; g < plan->N; g += 4*h )
+    {
+        for( k = 0; k < h; k++ )
+        {
+            float * a = x + 2*(g+k)*K, * b = a + 2*h*K, * c = b + 2*h*K, * d = c + 2*h*K;
+
+            w1r = plan->twiddleRe[2*(h-1+k)]; w1i = sign * plan->twiddleIm[2*(h-1+k)+1];
+            w2r = plan->twiddleRe[2*(2*h-1+k)]; w2i = sign * plan->twiddleIm[2*(2*h-1+k)+1];
+
+            for( f = f0; f < K; f++ )
+            {
+                tr = w1r*b[f] - w1i*b[K+f]; ti = w1r*b[K+f] + w1i*b[f];
+                a1r = a[f] + tr; a1i = a[K+f] + ti;
+                b1r = a[f] - tr; b1i = a[K+f] - ti;
+                tr = w1r*d[f] - w1i*d[K+f]; ti = w1r*d[K+f] + w1i*d[f];
+                c1r = c[f] + tr; c1i = c[K+f] + ti;
+                d1r = c[f] - tr; d1i = c[K+f] - ti;
+
+                tr = w2r*c1r - w2i*c1i; ti = w2r*c1i + w2i*c1r;
+                a[f] = a1r + tr; a[K+f] = a1i + ti;
+                c[f] = a1r - tr; c[K+f] = a1i - ti;
+                tr = -sign * (w2r*d1i + w2i*d1r); ti = sign * (w2r*d1r - w2i*d1i);
+                b[f] = b1r + tr; b[K+f] = b1i + ti;
+                d[f] = b1r - tr; d[K+f] = b1i - ti;
+            }
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_split()
+// desc: rfft split of points i and N-i, i = 1..N/2, on lanes f0..K (the
+//       loop body of plan_rfft() after i == 0)
+//-----------------------------------------------------------------------------
+static inline void batch_split( const fft_plan * plan, float * x, long K,
+                                unsigned int forward, long f0 )
+{
+    long N = plan->N, i, f;
+    float c1 = 0.5f, c2 = forward ? -0.5f : 0.5f, sign = forward ? 1.f : -1.f;
+    float h1r, h1i, h2r, h2i, wr, wi, ar, ai, cr, ci;
+
+    for( i = 1; i <= N>>1; i++ )
+    {
+        float * x1 = x + 2*i*K, * x2 = x1 + K;
+        float * x3 = x + 2*(N-i)*K, * x4 = x3 + K;
+
+        wr = plan->rtwiddle[2*i];
+        wi = sign * plan->rtwiddle[2*i+1];
+
+        for( f = f0; f < K; f++ )
+        {
+            ar = x1[f]; ai = x2[f]; cr = x3[f]; ci = x4[f];
+            h1r =  c1*(ar + cr);
+            h1i =  c1*(ai - ci);
+            h2r = -c2*(ai + ci);
+            h2i =  c2*(ar - cr);
+            x1[f] =  h1r + wr*h2r - wi*h2i;
+            x2[f] =  h1i + wr*h2i + wi*h2r;
+            x3[f] =  h1r - wr*h2r + wi*h2i;
+            x4[f] = -h1i + wr*h2i + wi*h2r;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_scalar()
+// desc: plain C batch kernel
+//-----------------------------------------------------------------------------
+static void batch_scalar( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    float sign = forward ? 1.f : -1.f;
+    float scale = (float)(forward ? 1./(2*plan->N) : 2.);
+    long h = 1, i;
+
+    batch_reverse( plan, x, K, 0 );
+    if( __builtin_ctzl( plan->N ) & 1 )
+    {
+        batch_radix2( x, plan->N, K, 0 );
+        h = 2;
+    }
+    for( ; h < plan->N; h <<= 2 )
+        batch_pass4( plan, x, K, h, sign, 0 );
+
+    for( i = 0; i < 2*plan->N*K; i++ )
+        x[i] *= scale;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_split_scalar()
+// desc: ...
+//-----------------------------------------------------------------------------
+static void batch_split_scalar( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    batch_split( plan, x, K, forward, 0 );
+}
+
+
+
+
+#ifdef FFT_X86
+//-----------------------------------------------------------------------------
+// name: batch_sse2()
+// desc: four frames per vector, leftover frames go through batch_pass4()
+//-----------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+static void batch_sse2( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    float sign = forward ? 1.f : -1.f;
+    long lanes = K & ~3L, h = 1, g, k, f;
+
+    for( k = 0; k < plan->numSwaps; k++ )
+    {
+        float * a = x + plan->swaps[2*k]*K, * b = x + plan->swaps[2*k+1]*K;
+
+        for( f = 0; f < lanes; f += 4 )
+        {
+            __m128 ar = _mm_loadu_ps( a + f ), ai = _mm_loadu_ps( a + K + f );
+            _mm_storeu_ps( a + f, _mm_loadu_ps( b + f ) );
+            _mm_storeu_ps( a + K + f, _mm_loadu_ps( b + K + f ) );
+            _mm_storeu_ps( b + f, ar );
+            _mm_storeu_ps( b + K + f, ai );
+        }
+    }
+    batch_reverse( plan, x, K, lanes );
+
+    if( __builtin_ctzl( plan->N ) & 1 )
+    {
+        for( g = 0; g < plan->N; g += 2 )
+        {
+            float * a = x + 2*g*K, * b = a + 2*K;
+
+            for( f = 0; f < lanes; f += 4 )
+            {
+                __m128 ar = _mm_loadu_ps( a + f ), ai = _mm_loadu_ps( a + K + f );
+                __m128 br = _mm_loadu_ps( b + f ), bi = _mm_loadu_ps( b + K + f );
+                _mm_storeu_ps( a + f, _mm_add_ps( ar, br ) );
+                _mm_storeu_ps( a + K + f, _mm_add_ps( ai, bi ) );
+                _mm_storeu_ps( b + f, _mm_sub_ps( ar, br ) );
+                _mm_storeu_ps( b + K + f, _mm_sub_ps( ai, bi ) );
+            }
+        }
+        batch_radix2( x, plan->N, K, lanes );
+        h = 2;
+    }
+
+    for( ; h < plan->N; h <<= 2 )
+    {
+        for( g = 0; g < plan->N; g += 4*h )
+        {
+            for( k = 0; k < h; k++ )
+            {
+                float * a = x + 2*(g+k)*K, * b = a + 2*h*K, * c = b + 2*h*K, * d = c + 2*h*K;
+                __m128 w1r = _mm_set1_ps( plan->twiddleRe[2*(h-1+k)] );
+                __m128 w1i = _mm_set1_ps( sign * plan->twiddleIm[2*(h-1+k)+1] );
+                __m128 w2r = _mm_set1_ps( plan->twiddleRe[2*(2*h-1+k)] );
+                __m128 w2i = _mm_set1_ps( sign * plan->twiddleIm[2*(2*h-1+k)+1] );
+                __m128 s = _mm_set1_ps( sign );
+
+                for( f = 0; f < lanes; f += 4 )
+                {
+                    __m128 ar = _mm_loadu_ps( a + f ), ai = _mm_loadu_ps( a + K + f );
+                    __m128 br = _mm_loadu_ps( b + f ), bi = _mm_loadu_ps( b + K + f );
+                    __m128 cr = _mm_loadu_ps( c + f ), ci = _mm_loadu_ps( c + K + f );
+                    __m128 dr = _mm_loadu_ps( d + f ), di = _mm_loadu_ps( d + K + f );
+                    __m128 tr, ti, a1r, a1i, b1r, b1i, c1r, c1i, d1r, d1i;
+
+                    tr = _mm_sub_ps( _mm_mul_ps( w1r, br ), _mm_mul_ps( w1i, bi ) );
+                    ti = _mm_add_ps( _mm_mul_ps( w1r, bi ), _mm_mul_ps( w1i, br ) );
+                    a1r = _mm_add_ps( ar, tr ); a1i = _mm_add_ps( ai, ti );
+                    b1r = _mm_sub_ps( ar, tr ); b1i = _mm_sub_ps( ai, ti );
+                    tr = _mm_sub_ps( _mm_mul_ps( w1r, dr ), _mm_mul_ps( w1i, di ) );
+                    ti = _mm_add_ps( _mm_mul_ps( w1r, di ), _mm_mul_ps( w1i, dr ) );
+                    c1r = _mm_add_ps( cr, tr ); c1i = _mm_add_ps( ci, ti );
+                    d1r = _mm_sub_ps( cr, tr ); d1i = _mm_sub_ps( ci, ti );
+
+                    tr = _mm_sub_ps( _mm_mul_ps( w2r, c1r ), _mm_mul_ps( w2i, c1i ) );
+                    ti = _mm_add_ps( _mm_mul_ps( w2r, c1i ), _mm_mul_ps( w2i, c1r ) );
+                    _mm_storeu_ps( a + f, _mm_add_ps( a1r, tr ) );
+                    _mm_storeu_ps( a + K + f, _mm_add_ps( a1i, ti ) );
+                    _mm_storeu_ps( c + f, _mm_sub_ps( a1r, tr ) );
+                    _mm_storeu_ps( c + K + f, _mm_sub_ps( a1i, ti ) );
+
+                    // times +-i
+                    tr = _mm_mul_ps( s, _mm_add_ps( _mm_mul_ps( w2r, d1i ), _mm_mul_ps( w2i, d1r ) ) );
+                    ti = _mm_mul_ps( s, _mm_sub_ps( _mm_mul_ps( w2r, d1r ), _mm_mul_ps( w2i, d1i ) ) );
+                    _mm_storeu_ps( b + f, _mm_sub_ps( b1r, tr ) );
+                    _mm_storeu_ps( b + K + f, _mm_add_ps( b1i, ti ) );
+                    _mm_storeu_ps( d + f, _mm_add_ps( b1r, tr ) );
+                    _mm_storeu_ps( d + K + f, _mm_sub_ps( b1i, ti ) );
+                }
+            }
+        }
+        batch_pass4( plan, x, K, h, sign, lanes );
+    }
+
+    // scale output
+    {
+        __m128 scale = _mm_set1_ps( (float)(forward ? 1./(2*plan->N) : 2.) );
+        long n = 2*plan->N*K, i;
+
+        for( i = 0; i + 4 <= n; i += 4 )
+            _mm_storeu_ps( x + i, _mm_mul_ps( _mm_loadu_ps( x + i ), scale ) );
+        for( ; i < n; i++ )
+            x[i] *= _mm_cvtss_f32( scale );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_split_sse2()
+// desc: batch_split() four frames per vector
+//-----------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+static void batch_split_sse2( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    long N = plan->N, lanes = K & ~3L, i, f;
+    float sign = forward ? 1.f : -1.f;
+    __m128 c1 = _mm_set1_ps( 0.5f ), c2 = _mm_set1_ps( forward ? -0.5f : 0.5f );
+
+    for( i = 1; i <= N>>1; i++ )
+    {
+        float * x1 = x + 2*i*K, * x2 = x1 + K;
+        float * x3 = x + 2*(N-i)*K, * x4 = x3 + K;
+        __m128 wr = _mm_set1_ps( plan->rtwiddle[2*i] );
+        __m128 wi = _mm_set1_ps( sign * plan->rtwiddle[2*i+1] );
+
+        for( f = 0; f < lanes; f += 4 )
+        {
+            __m128 ar = _mm_loadu_ps( x1 + f ), ai = _mm_loadu_ps( x2 + f );
+            __m128 cr = _mm_loadu_ps( x3 + f ), ci = _mm_loadu_ps( x4 + f );
+            __m128 h1r = _mm_mul_ps( c1, _mm_add_ps( ar, cr ) );
+            __m128 h1i = _mm_mul_ps( c1, _mm_sub_ps( ai, ci ) );
+            __m128 h2r = _mm_mul_ps( c2, _mm_add_ps( ai, ci ) );// negated
+            __m128 h2i = _mm_mul_ps( c2, _mm_sub_ps( ar, cr ) );
+            __m128 tr = _mm_add_ps( _mm_mul_ps( wr, h2r ), _mm_mul_ps( wi, h2i ) );// -(wr*h2r - wi*h2i)
+            __m128 ti = _mm_sub_ps( _mm_mul_ps( wr, h2i ), _mm_mul_ps( wi, h2r ) );// wr*h2i + wi*h2r
+
+            _mm_storeu_ps( x1 + f, _mm_sub_ps( h1r, tr ) );
+            _mm_storeu_ps( x2 + f, _mm_add_ps( h1i, ti ) );
+            _mm_storeu_ps( x3 + f, _mm_add_ps( h1r, tr ) );
+            _mm_storeu_ps( x4 + f, _mm_sub_ps( ti, h1i ) );
+        }
+    }
+    batch_split( plan, x, K, forward, lanes );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_avx2()
+// desc: eight frames per vector with fused multiply-add
+//-----------------------------------------------------------------------------
+__attribute__(( target( "avx2,fma" ) ))
+static void batch_avx2( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    float sign = forward ? 1.f : -1.f;
+    long lanes = K & ~7L, h = 1, g, k, f;
+
+    for( k = 0; k < plan->numSwaps; k++ )
+    {
+        float * a = x + plan->swaps[2*k]*K, * b = x + plan->swaps[2*k+1]*K;
+
+        for( f = 0; f < lanes; f += 8 )
+        {
+            __m256 ar = _mm256_loadu_ps( a + f ), ai = _mm256_loadu_ps( a + K + f );
+            _mm256_storeu_ps( a + f, _mm256_loadu_ps( b + f ) );
+            _mm256_storeu_ps( a + K + f, _mm256_loadu_ps( b + K + f ) );
+            _mm256_storeu_ps( b + f, ar );
+            _mm256_storeu_ps( b + K + f, ai );
+        }
+    }
+    batch_reverse( plan, x, K, lanes );
+
+    if( __builtin_ctzl( plan->N ) & 1 )
+    {
+        for( g = 0; g < plan->N; g += 2 )
+        {
+            float * a = x + 2*g*K, * b = a + 2*K;
+
+            for( f = 0; f < lanes; f += 8 )
+            {
+                __m256 ar = _mm256_loadu_ps( a + f ), ai = _mm256_loadu_ps( a + K + f );
+                __m256 br = _mm256_loadu_ps( b + f ), bi = _mm256_loadu_ps( b + K + f );
+                _mm256_storeu_ps( a + f, _mm256_add_ps( ar, br ) );
+                _mm256_storeu_ps( a + K + f, _mm256_add_ps( ai, bi ) );
+                _mm256_storeu_ps( b + f, _mm256_sub_ps( ar, br ) );
+                _mm256_storeu_ps( b + K + f, _mm256_sub_ps( ai, bi ) );
+            }
+        }
+        batch_radix2( x, plan->N, K, lanes );
+        h = 2;
+    }
+
+    for( ; h < plan->N; h <<= 2 )
+    {
+        for( g = 0; g < plan->N; g += 4*h )
+        {
+            for( k = 0; k < h; k++ )
+            {
+                float * a = x + 2*(g+k)*K, * b = a + 2*h*K, * c = b + 2*h*K, * d = c + 2*h*K;
+                __m256 w1r = _mm256_set1_ps( plan->twiddleRe[2*(h-1+k)] );
+                __m256 w1i = _mm256_set1_ps( sign * plan->twiddleIm[2*(h-1+k)+1] );
+                __m256 w2r = _mm256_set1_ps( plan->twiddleRe[2*(2*h-1+k)] );
+                __m256 w2i = _mm256_set1_ps( sign * plan->twiddleIm[2*(2*h-1+k)+1] );
+                __m256 s = _mm256_set1_ps( sign );
+
+                for( f = 0; f < lanes; f += 8 )
+                {
+                    __m256 ar = _mm256_loadu_ps( a + f ), ai = _mm256_loadu_ps( a + K + f );
+                    __m256 br = _mm256_loadu_ps( b + f ), bi = _mm256_loadu_ps( b + K + f );
+                    __m256 cr = _mm256_loadu_ps( c + f ), ci = _mm256_loadu_ps( c + K + f );
+                    __m256 dr = _mm256_loadu_ps( d + f ), di = _mm256_loadu_ps( d + K + f );
+                    __m256 tr, ti, a1r, a1i, b1r, b1i, c1r, c1i, d1r, d1i;
+
+                    tr = _mm256_fmsub_ps( w1r, br, _mm256_mul_ps( w1i, bi ) );
+                    ti = _mm256_fmadd_ps( w1r, bi, _mm256_mul_ps( w1i, br ) );
+                    a1r = _mm256_add_ps( ar, tr ); a1i = _mm256_add_ps( ai, ti );
+                    b1r = _mm256_sub_ps( ar, tr ); b1i = _mm256_sub_ps( ai, ti );
+                    tr = _mm256_fmsub_ps( w1r, dr, _mm256_mul_ps( w1i, di ) );
+                    ti = _mm256_fmadd_ps( w1r, di, _mm256_mul_ps( w1i, dr ) );
+                    c1r = _mm256_add_ps( cr, tr ); c1i = _mm256_add_ps( ci, ti );
+                    d1r = _mm256_sub_ps( cr, tr ); d1i = _mm256_sub_ps( ci, ti );
+
+                    tr = _mm256_fmsub_ps( w2r, c1r, _mm256_mul_ps( w2i, c1i ) );
+                    ti = _mm256_fmadd_ps( w2r, c1i, _mm256_mul_ps( w2i, c1r ) );
+                    _mm256_storeu_ps( a + f, _mm256_add_ps( a1r, tr ) );
+                    _mm256_storeu_ps( a + K + f, _mm256_add_ps( a1i, ti ) );
+                    _mm256_storeu_ps( c + f, _mm256_sub_ps( a1r, tr ) );
+                    _mm256_storeu_ps( c + K + f, _mm256_sub_ps( a1i, ti ) );
+
+                    // times +-i
+                    tr = _mm256_mul_ps( s, _mm256_fmadd_ps( w2r, d1i, _mm256_mul_ps( w2i, d1r ) ) );
+                    ti = _mm256_mul_ps( s, _mm256_fmsub_ps( w2r, d1r, _mm256_mul_ps( w2i, d1i ) ) );
+                    _mm256_storeu_ps( b + f, _mm256_sub_ps( b1r, tr ) );
+                    _mm256_storeu_ps( b + K + f, _mm256_add_ps( b1i, ti ) );
+                    _mm256_storeu_ps( d + f, _mm256_add_ps( b1r, tr ) );
+                    _mm256_storeu_ps( d + K + f, _mm256_sub_ps( b1i, ti ) );
+                }
+            }
+        }
+        batch_pass4( plan, x, K, h, sign, lanes );
+    }
+
+    // scale output
+    {
+        __m256 scale = _mm256_set1_ps( (float)(forward ? 1./(2*plan->N) : 2.) );
+        long n = 2*plan->N*K, i;
+
+        for( i = 0; i + 8 <= n; i += 8 )
+            _mm256_storeu_ps( x + i, _mm256_mul_ps( _mm256_loadu_ps( x + i ), scale ) );
+        for( ; i < n; i++ )
+            x[i] *= _mm256_cvtss_f32( scale );
+    }
+
+    // avoid the AVX/SSE transition penalty in whatever runs next
+    _mm256_zeroupper();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch_split_avx2()
+// desc: batch_split() eight frames per vector
+//-----------------------------------------------------------------------------
+__attribute__(( target( "avx2,fma" ) ))
+static void batch_split_avx2( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    long N = plan->N, lanes = K & ~7L, i, f;
+    float sign = forward ? 1.f : -1.f;
+    __m256 c1 = _mm256_set1_ps( 0.5f ), c2 = _mm256_set1_ps( forward ? -0.5f : 0.5f );
+
+    for( i = 1; i <= N>>1; i++ )
+    {
+        float * x1 = x + 2*i*K, * x2 = x1 + K;
+        float * x3 = x + 2*(N-i)*K, * x4 = x3 + K;
+        __m256 wr = _mm256_set1_ps( plan->rtwiddle[2*i] );
+        __m256 wi = _mm256_set1_ps( sign * plan->rtwiddle[2*i+1] );
+
+        for( f = 0; f < lanes; f += 8 )
+        {
+            __m256 ar = _mm256_loadu_ps( x1 + f ), ai = _mm256_loadu_ps( x2 + f );
+            __m256 cr = _mm256_loadu_ps( x3 + f ), ci = _mm256_loadu_ps( x4 + f );
+            __m256 h1r = _mm256_mul_ps( c1, _mm256_add_ps( ar, cr ) );
+            __m256 h1i = _mm256_mul_ps( c1, _mm256_sub_ps( ai, ci ) );
+            __m256 h2r = _mm256_mul_ps( c2, _mm256_add_ps( ai, ci ) );// negated
+            __m256 h2i = _mm256_mul_ps( c2, _mm256_sub_ps( ar, cr ) );
+            __m256 tr = _mm256_fmadd_ps( wr, h2r, _mm256_mul_ps( wi, h2i ) );// -(wr*h2r - wi*h2i)
+            __m256 ti = _mm256_fmsub_ps( wr, h2i, _mm256_mul_ps( wi, h2r ) );// wr*h2i + wi*h2r
+
+            _mm256_storeu_ps( x1 + f, _mm256_sub_ps( h1r, tr ) );
+            _mm256_storeu_ps( x2 + f, _mm256_add_ps( h1i, ti ) );
+            _mm256_storeu_ps( x3 + f, _mm256_add_ps( h1r, tr ) );
+            _mm256_storeu_ps( x4 + f, _mm256_sub_ps( ti, h1i ) );
+        }
+    }
+    batch_split( plan, x, K, forward, lanes );
+
+    // avoid the AVX/SSE transition penalty in whatever runs next
+    _mm256_zeroupper();
+}
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_kernels()
+// desc: build the kernel list for this cpu on first use
+//-----------------------------------------------------------------------------
+const fft_kernel * fft_kernels( int * count )
+{
+    static fft_kernel kernels[3];
+    static int numKernels = 0;
+    int n = 0;
+
+    if( numKernels == 0 )
+    {
+#ifdef FFT_X86
+        __builtin_cpu_init();
+        if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+        {
+            kernels[n].name = "avx2"; kernels[n].func = fft_avx2;
+            kernels[n].batch = batch_avx2;
+            kernels[n].batchSplit = batch_split_avx2; n++;
+        }
+        if( __builtin_cpu_supports( "sse2" ) )
+        {
+            kernels[n].name = "sse2"; kernels[n].func = fft_sse2;
+            kernels[n].batch = batch_sse2;
+            kernels[n].batchSplit = batch_split_sse2; n++;
+        }
+#endif
+        kernels[n].name = "scalar"; kernels[n].func = fft_scalar;
+        kernels[n].batch = batch_scalar;
+        kernels[n].batchSplit = batch_split_scalar; n++;
+        numKernels = n;
+    }
+
+    *count = numKernels;
+    return kernels;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_create()
+// desc: twiddles are computed in double once here, the transforms below
+//       only look them up
+//-----------------------------------------------------------------------------
+fft_plan * fft_plan_create( long N )
+{
+    fft_plan * plan;
+    double pi = FFT_PI;
+    long i, j, m, k, h, ND = N<<1;
+    int numKernels;
+
+    if( N < 2 || (N & (N - 1)) != 0 )
+        return NULL;
+
+    plan = (fft_plan *)calloc( 1, sizeof(fft_plan) );
+    if( plan == NULL )
+        return NULL;
+
+    plan->N = N;
+    plan->twiddleRe = (float *)malloc( ND * sizeof(float) );
+    plan->twiddleIm = (float *)malloc( ND * sizeof(float) );
+    plan->rtwiddle = (float *)malloc( (N + 2) * sizeof(float) );
+    plan->swaps = (long *)malloc( N * sizeof(long) );
+    if( plan->twiddleRe == NULL || plan->twiddleIm == NULL ||
+        plan->rtwiddle == NULL || plan->swaps == NULL )
+    {
+        fft_plan_free( plan );
+        return NULL;
+    }
+
+    // laid out so a vector of complex values multiplies with no shuffling
+    // of the twiddles: (re*c - im*s, im*c + re*s) = x*(c, c) + swap(x)*(-s, s)
+    for( h = 1; h < N; h <<= 1 )
+    {
+        for( k = 0; k < h; k++ )
+        {
+            i = 2*(h - 1 + k);
+            plan->twiddleRe[i] = plan->twiddleRe[i+1] = (float)cos( pi * k / h );
+            plan->twiddleIm[i] = -(float)sin( pi * k / h );
+            plan->twiddleIm[i+1] = (float)sin( pi * k / h );
+        }
+    }
+    for( k = 0; k <= N/2; k++ )
+    {
+        plan->rtwiddle[2*k] = (float)cos( pi * k / N );
+        plan->rtwiddle[2*k+1] = (float)sin( pi * k / N );
+    }
+
+    // same walk as bit_reverse(), recording the exchanges instead
+    for( i = j = 0; i < ND; i += 2, j += m )
+    {
+        if( j > i )
+        {
+            plan->swaps[2*plan->numSwaps] = i;
+            plan->swaps[2*plan->numSwaps+1] = j;
+            plan->numSwaps++;
+        }
+
+        for( m = ND>>1; m >= 2 && j >= m; m >>= 1 )
+            j -= m;
+    }
+
+    plan->kernel = &fft_kernels( &numKernels )[0];
+
+    return plan;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_free()
+// desc: ...
+//-----------------------------------------------------------------------------
+void fft_plan_free( fft_plan * plan )
+{
+    if( plan == NULL )
+        return;
+
+    free( plan->twiddleRe );
+    free( plan->twiddleIm );
+    free( plan->rtwiddle );
+    free( plan->swaps );
+    free( plan );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: plan_rfft()
+// desc: rfft() against a plan, x holds 2*plan->N floats
+//-----------------------------------------------------------------------------
+void plan_rfft( const fft_plan * plan, float * x, unsigned int forward )
+{
+    long N = plan->N;
+    const float * w = plan->rtwiddle;
+    float c1 = 0.5f, c2, sign, h1r, h1i, h2r, h2i, wr, wi, xr, xi;
+    long i, i1, i2, i3, i4, N2p1 = (N<<1) + 1;
+
+    if( forward )
+    {
+        c2 = -0.5f;
+        sign = 1.f;
+        plan_cfft( plan, x, forward );
+        xr = x[0];
+        xi = x[1];
+    }
+    else
+    {
+        c2 = 0.5f;
+        sign = -1.f;
+        xr = x[1];
+        xi = 0.f;
+        x[1] = 0.f;
+    }
+
+    // i == 0 pairs with the value saved from x[0..1]
+    wr = w[0];
+    wi = sign * w[1];
+    h1r =  c1*(x[0] + xr);
+    h1i =  c1*(x[1] - xi);
+    h2r = -c2*(x[1] + xi);
+    h2i =  c2*(x[0] - xr);
+    x[0] =  h1r + wr*h2r - wi*h2i;
+    x[1] =  h1i + wr*h2i + wi*h2r;
+    xr =  h1r - wr*h2r + wi*h2i;
+    xi = -h1i + wr*h2i + wi*h2r;
+
+    for( i = 1; i <= N>>1; i++ )
+    {
+        i1 = i<<1;
+        i2 = i1 + 1;
+        i3 = N2p1 - i2;
+        i4 = i3 + 1;
+        wr = w[i1];
+        wi = sign * w[i2];
+
+        h1r =  c1*(x[i1] + x[i3]);
+        h1i =  c1*(x[i2] - x[i4]);
+        h2r = -c2*(x[i2] + x[i4]);
+        h2i =  c2*(x[i1] - x[i3]);
+        x[i1] =  h1r + wr*h2r - wi*h2i;
+        x[i2] =  h1i + wr*h2i + wi*h2r;
+        x[i3] =  h1r - wr*h2r + wi*h2i;
+        x[i4] = -h1i + wr*h2i + wi*h2r;
+    }
+
+    if( forward )
+        x[1] = xr;
+    else
+        plan_cfft( plan, x, forward );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: plan_cfft()
+// desc: cfft() against a plan, x holds plan->N complex values
+//-----------------------------------------------------------------------------
+void plan_cfft( const fft_plan * plan, float * x, unsigned int forward )
+{
+    long ND = plan->N<<1;
+    const long * sw = plan->swaps;
+    float scale, rtemp, itemp;
+    long i, j, k;
+
+    for( k = 0; k < plan->numSwaps; k++ )
+    {
+        i = sw[2*k];
+        j = sw[2*k+1];
+        rtemp = x[j]; itemp = x[j+1];
+        x[j] = x[i]; x[j+1] = x[i+1];
+        x[i] = rtemp; x[i+1] = itemp;
+    }
+
+    plan->kernel->func( plan, x, forward );
+
+    // scale output
+    scale = (float)(forward ? 1./ND : 2.);
+    for( i = 0; i < ND; i++ )
+        x[i] *= scale;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: plan_rfft_batch()
+// desc: plan_rfft() on K frames in the transposed layout
+//-----------------------------------------------------------------------------
+void plan_rfft_batch( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    const float * w = plan->rtwiddle;
+    float c1 = 0.5f, c2 = forward ? -0.5f : 0.5f, sign = forward ? 1.f : -1.f;
+    float h1r, h1i, h2r, h2i, wr, wi, xr, xi;
+    long f;
+
+    if( forward )
+        plan_cfft_batch( plan, x, K, forward );
+
+    // i == 0 pairs a frame's x[0..1] with itself (dc and nyquist), and
+    // nothing after it touches them, so each frame finishes it right away
+    wr = w[0];
+    wi = sign * w[1];
+    for( f = 0; f < K; f++ )
+    {
+        float * x0 = x + f, * x1 = x + K + f;
+
+        if( forward )
+        {
+            xr = *x0;
+            xi = *x1;
+        }
+        else
+        {
+            xr = *x1;
+            xi = 0.f;
+            *x1 = 0.f;
+        }
+        h1r =  c1*(*x0 + xr);
+        h1i =  c1*(*x1 - xi);
+        h2r = -c2*(*x1 + xi);
+        h2i =  c2*(*x0 - xr);
+        *x0 = h1r + wr*h2r - wi*h2i;
+        *x1 = forward ? h1r - wr*h2r + wi*h2i : h1i + wr*h2i + wi*h2r;
+    }
+
+    plan->kernel->batchSplit( plan, x, K, forward );
+
+    if( !forward )
+        plan_cfft_batch( plan, x, K, forward );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: plan_cfft_batch()
+// desc: plan_cfft() on K frames in the transposed layout
+//-----------------------------------------------------------------------------
+void plan_cfft_batch( const fft_plan * plan, float * x, long K, unsigned int forward )
+{
+    // bit reversal, butterflies and scaling
+    plan->kernel->batch( plan, x, K, forward );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_init()
+// desc: ...
+//-----------------------------------------------------------------------------
+int stft_init( stft_context * ctx, const fft_plan * plan, const float * window, long hop )
+{
+    ctx->plan = plan;
+    ctx->window = window;
+    ctx->size = plan->N<<1;
+    ctx->hop = hop;
+    ctx->fill = 0;
+    ctx->gain = (float)(2. * hop / plan->N);
+    ctx->frame = (float *)calloc( ctx->size, sizeof(float) );
+    ctx->left = (float *)calloc( plan->N, sizeof(float) );
+    ctx->right = (float *)calloc( plan->N, sizeof(float) );
+    ctx->input = (float *)calloc( ctx->size, sizeof(float) );
+    ctx->output = (float *)calloc( ctx->size, sizeof(float) );
+    if( ctx->frame == NULL || ctx->left == NULL || ctx->right == NULL ||
+        ctx->input == NULL || ctx->output == NULL )
+    {
+        stft_free( ctx );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_free()
+// desc: ...
+//-----------------------------------------------------------------------------
+void stft_free( stft_context * ctx )
+{
+    free( ctx->frame );
+    free( ctx->left );
+    free( ctx->right );
+    free( ctx->input );
+    free( ctx->output );
+    ctx->frame = ctx->left = ctx->right = NULL;
+    ctx->input = ctx->output = NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_reset()
+// desc: ...
+//-----------------------------------------------------------------------------
+void stft_reset( stft_context * ctx )
+{
+    ctx->fill = 0;
+    memset( ctx->input, 0, ctx->size * sizeof(float) );
+    memset( ctx->output, 0, ctx->size * sizeof(float) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_analyze()
+// desc: ...
+//-----------------------------------------------------------------------------
+complex * stft_analyze( stft_context * ctx, const float * in )
+{
+    long i;
+
+    for( i = 0; i < ctx->size; i++ )
+        ctx->frame[i] = in[i] * ctx->window[i];
+    plan_rfft( ctx->plan, ctx->frame, FFT_FORWARD );
+
+    return (complex *)ctx->frame;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_synthesize()
+// desc: ...
+//-----------------------------------------------------------------------------
+float * stft_synthesize( stft_context * ctx )
+{
+    plan_rfft( ctx->plan, ctx->frame, FFT_INVERSE );
+    return ctx->frame;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_analyze_stereo()
+// desc: with z = l + i*r and Z its transform, the channels come back out
+//       through conjugate symmetry:
+//         L[k] = Z[k] + conj(Z[W-k])
+//         R[k] = -i * (Z[k] - conj(Z[W-k]))
+//       which is exactly what plan_rfft would give for each channel
+//-----------------------------------------------------------------------------
+void stft_analyze_stereo( stft_context * ctx, const float * in, const float * window )
+{
+    long W = ctx->plan->N, N = W>>1, i, k;
+    float * Z = ctx->frame, * L = ctx->left, * R = ctx->right;
+    float ar, ai, br, bi;
+
+    if( window != NULL )
+    {
+        for( i = 0; i < W; i++ )
+        {
+            Z[2*i] = in[2*i] * window[i];
+            Z[2*i+1] = in[2*i+1] * window[i];
+        }
+    }
+    else
+    {
+        for( i = 0; i < 2*W; i++ )
+            Z[i] = in[i];
+    }
+    plan_cfft( ctx->plan, Z, FFT_FORWARD );
+
+    // dc and nyquist are real for each channel, packed as (dc, nyquist)
+    L[0] = 2.f * Z[0]; R[0] = 2.f * Z[1];
+    L[1] = 2.f * Z[2*N]; R[1] = 2.f * Z[2*N+1];
+
+    for( k = 1; k < N; k++ )
+    {
+        ar = Z[2*k]; ai = Z[2*k+1];
+        br = Z[2*(W-k)]; bi = Z[2*(W-k)+1];
+        L[2*k] = ar + br; L[2*k+1] = ai - bi;
+        R[2*k] = ai + bi; R[2*k+1] = br - ar;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_synthesize_stereo()
+// desc: rebuilds Z[k] = (L[k] + i*R[k]) / 2 and its mirror
+//       Z[W-k] = (conj(L[k]) + i*conj(R[k])) / 2, then one inverse fft
+//-----------------------------------------------------------------------------
+float * stft_synthesize_stereo( stft_context * ctx )
+{
+    long W = ctx->plan->N, N = W>>1, k;
+    float * Z = ctx->frame;
+    const float * L = ctx->left, * R = ctx->right;
+    float lr, li, rr, ri;
+
+    Z[0] = 0.5f * L[0]; Z[1] = 0.5f * R[0];
+    Z[2*N] = 0.5f * L[1]; Z[2*N+1] = 0.5f * R[1];
+
+    for( k = 1; k < N; k++ )
+    {
+        lr = L[2*k]; li = L[2*k+1];
+        rr = R[2*k]; ri = R[2*k+1];
+        Z[2*k] = 0.5f * (lr - ri); Z[2*k+1] = 0.5f * (li + rr);
+        Z[2*(W-k)] = 0.5f * (lr + ri); Z[2*(W-k)+1] = 0.5f * (rr - li);
+    }
+    plan_cfft( ctx->plan, Z, FFT_INVERSE );
+
+    return Z;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stft_stream_stereo()
+// desc: weighted overlap-add.  the previous windows live on only as their
+//       share of ctx->output, so nothing is ever transformed twice
+//-----------------------------------------------------------------------------
+void stft_stream_stereo( stft_context * ctx, float * buffer, long frames,
+                         stft_func process, void * user )
+{
+    long W = ctx->plan->N, hop = ctx->hop, n, j;
+    float * in = ctx->input, * out = ctx->output;
+
+    while( frames > 0 )
+    {
+        n = hop - ctx->fill;
+        if( n > frames )
+            n = frames;
+
+        // the newest hop of the window fills up while the finished front
+        // of the overlap tail goes out in its place
+        memcpy( in + 2*(W - hop + ctx->fill), buffer, 2*n * sizeof(float) );
+        memcpy( buffer, out + 2*ctx->fill, 2*n * sizeof(float) );
+        ctx->fill += n;
+        buffer += 2*n;
+        frames -= n;
+
+        if( ctx->fill == hop )
+        {
+            stft_analyze_stereo( ctx, in, ctx->window );
+            process( ctx, user );
+            stft_synthesize_stereo( ctx );
+
+            memmove( out, out + 2*hop, 2*(W - hop) * sizeof(float) );
+            memset( out + 2*(W - hop), 0, 2*hop * sizeof(float) );
+            for( j = 0; j < 2*W; j++ )
+                out[j] += ctx->gain * ctx->frame[j];
+
+            memmove( in, in + 2*hop, 2*(W - hop) * sizeof(float) );
+            ctx->fill = 0;
+        }
+    }
+}
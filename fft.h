@@ -20,6 +20,60 @@ typedef struct { float re ; float im ; } complex;
 #define FFT_FORWARD 1
 #define FFT_INVERSE 0
 
+typedef struct fft_plan fft_plan;
+
+// butterfly passes over bit-reversed data, one per instruction set
+typedef void (* fft_func)( const fft_plan * plan, float * x, unsigned int forward );
+// the whole cfft over K transposed frames (see plan_cfft_batch);
+// also the real-fft split step of plan_rfft_batch
+typedef void (* fft_batch_func)( const fft_plan * plan, float * x, long K, unsigned int forward );
+
+typedef struct {
+    const char * name;
+    fft_func func;
+    fft_batch_func batch;
+    fft_batch_func batchSplit;
+} fft_kernel;
+
+// tables for one transform size, made once and shared by every call
+struct fft_plan {
+    long N;              // complex points in the cfft (rfft of 2*N reals)
+    float * twiddleRe;   // cfft: exp(i*pi*k/h), k < h, for each pass h = 1..N/2
+    float * twiddleIm;   //   at complex offset h-1, as (cos, cos) and (-sin, sin)
+    float * rtwiddle;    // rfft: exp(i*pi*k/N), k <= N/2, re/im pairs
+    long * swaps;        // bit reversal: float offsets to exchange, in pairs
+    long numSwaps;
+    const fft_kernel * kernel;// best for this cpu, may be changed by the caller
+};
+
+// per-signal short-time transform state, owned by the caller; the plan and
+// window are only read, so any number of contexts can share them and run
+// on different threads at once.
+//
+// mono: frames of 2*plan->N reals through plan_rfft, window of 2*plan->N.
+// stereo: frames of plan->N interleaved L/R pairs through one plan_cfft
+// with L as the real and R as the imaginary part, window of plan->N.
+typedef struct stft_context stft_context;
+
+// edits the spectra of one hop in place (ctx->left / ctx->right)
+typedef void (* stft_func)( stft_context * ctx, void * user );
+
+struct stft_context {
+    const fft_plan * plan;
+    const float * window;
+    long size;              // frame length in floats, 2*plan->N
+    float * frame;          // windowed frame, then its spectrum
+    float * left;           // stereo: plan->N/2 bins per channel, packed
+    float * right;          //   like a forward rfft (x[1] is nyquist)
+    // streaming (stereo): each hop is transformed once, its inverse is
+    // added into the overlap tail and the finished hop goes out
+    long hop;               // frames between windows, divides plan->N/2
+    long fill;              // frames of the current hop taken so far
+    float gain;             // overlap-add gain for a hann window, 2*hop/N
+    float * input;          // last plan->N frames in, interleaved
+    float * output;         // overlap-add tail, interleaved
+};
+
 // c linkage
 #if ( defined( __cplusplus ) || defined( _cplusplus ) )
   extern "C" {
@@ -37,6 +91,42 @@ void rfft( float * x, long N, unsigned int forward );
 // complex fft, NC must be power of 2
 void cfft( float * x, long NC, unsigned int forward );
 
+// every butterfly kernel this cpu can run, best first (scalar is last)
+const fft_kernel * fft_kernels( int * count );
+
+// plan for rfft( x, N ) / cfft( x, N ), N power of 2 and >= 2; NULL on failure
+fft_plan * fft_plan_create( long N );
+void fft_plan_free( fft_plan * plan );
+// same results as rfft / cfft with plan->N (to float rounding), radix-4
+// and vectorized, without any trig per call
+void plan_rfft( const fft_plan * plan, float * x, unsigned int forward );
+void plan_cfft( const fft_plan * plan, float * x, unsigned int forward );
+// K frames in one call, transposed so value i of frame f is x[i*K + f];
+// vector lanes run across frames, so K a multiple of 8 (avx2) or 4 (sse2)
+// keeps every lane busy.  a frame's result matches plan_rfft / plan_cfft
+void plan_rfft_batch( const fft_plan * plan, float * x, long K, unsigned int forward );
+void plan_cfft_batch( const fft_plan * plan, float * x, long K, unsigned int forward );
+
+// allocate the scratch of a context, returns 0 on success
+int stft_init( stft_context * ctx, const fft_plan * plan, const float * window, long hop );
+void stft_free( stft_context * ctx );
+// forget everything streamed so far
+void stft_reset( stft_context * ctx );
+// window size reals of in into ctx->frame and transform them in place
+complex * stft_analyze( stft_context * ctx, const float * in );
+// spectrum in ctx->frame back to size reals in ctx->frame
+float * stft_synthesize( stft_context * ctx );
+// stereo: in (times window, if not NULL) into ctx->frame, one complex fft,
+// then ctx->left / ctx->right get the two channel spectra
+void stft_analyze_stereo( stft_context * ctx, const float * in, const float * window );
+// stereo: ctx->left / ctx->right back to interleaved L/R in ctx->frame
+float * stft_synthesize_stereo( stft_context * ctx );
+// stereo: filter frames of interleaved audio in place, calling process on
+// every hop's spectra.  one forward and one inverse fft per hop; the
+// output runs plan->N frames behind the input
+void stft_stream_stereo( stft_context * ctx, float * buffer, long frames,
+                         stft_func process, void * user );
+
 // c linkage
 #if ( defined( __cplusplus ) || defined( _cplusplus ) )
   }
@@ -0,0 +1,284 @@
+//-----------------------------------------------------------------------------
+// name: mixer.c
+// desc: slice summing kernels
+//
+//   the vector kernels take the slices four at a time so the output is
+//   loaded and stored once per four sources instead of once per source.
+//-----------------------------------------------------------------------------
+#include "mixer.h"
+#include <string.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+  #define MIX_X86 1
+  #include <immintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+  #define MIX_NEON 1
+  #include <arm_neon.h>
+#endif
+
+
+static void mix_resolve( float * out, const float * const * src,
+                         const float * gain, int count, long samples );
+
+static mix_kernel g_kernels[4];
+static int g_num_kernels = 0;
+static mix_func g_mix = mix_resolve;
+static const char * g_mix_name = "none";
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_scalar()
+// desc: plain C kernel, also used for the tails of the vector kernels
+//-----------------------------------------------------------------------------
+static void mix_scalar( float * out, const float * const * src,
+                        const float * gain, int count, long samples )
+{
+    long i;
+    int s;
+
+    memset( out, 0, samples * sizeof(float) );
+
+    for( s = 0; s < count; s++ )
+    {
+        const float * x = src[s];
+        float g = gain[s];
+
+        for( i = 0; i < samples; i++ )
+            out[i] += g * x[i];
+    }
+}
+
+
+
+
+#ifdef MIX_X86
+//-----------------------------------------------------------------------------
+// name: mix_sse2()
+// desc: 4 samples per step
+//-----------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+static void mix_sse2( float * out, const float * const * src,
+                      const float * gain, int count, long samples )
+{
+    long i;
+    int s = 0;
+
+    memset( out, 0, samples * sizeof(float) );
+
+    for( ; s + 4 <= count; s += 4 )
+    {
+        const float * a = src[s], * b = src[s+1], * c = src[s+2], * d = src[s+3];
+        __m128 ga = _mm_set1_ps( gain[s] ), gb = _mm_set1_ps( gain[s+1] );
+        __m128 gc = _mm_set1_ps( gain[s+2] ), gd = _mm_set1_ps( gain[s+3] );
+
+        for( i = 0; i + 4 <= samples; i += 4 )
+        {
+            __m128 acc = _mm_loadu_ps( out + i );
+            acc = _mm_add_ps( acc, _mm_mul_ps( ga, _mm_loadu_ps( a + i ) ) );
+            acc = _mm_add_ps( acc, _mm_mul_ps( gb, _mm_loadu_ps( b + i ) ) );
+            acc = _mm_add_ps( acc, _mm_mul_ps( gc, _mm_loadu_ps( c + i ) ) );
+            acc = _mm_add_ps( acc, _mm_mul_ps( gd, _mm_loadu_ps( d + i ) ) );
+            _mm_storeu_ps( out + i, acc );
+        }
+        for( ; i < samples; i++ )
+            out[i] += gain[s]*a[i] + gain[s+1]*b[i] + gain[s+2]*c[i] + gain[s+3]*d[i];
+    }
+
+    for( ; s < count; s++ )
+    {
+        const float * a = src[s];
+        __m128 ga = _mm_set1_ps( gain[s] );
+
+        for( i = 0; i + 4 <= samples; i += 4 )
+            _mm_storeu_ps( out + i, _mm_add_ps( _mm_loadu_ps( out + i ),
+                           _mm_mul_ps( ga, _mm_loadu_ps( a + i ) ) ) );
+        for( ; i < samples; i++ )
+            out[i] += gain[s] * a[i];
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_avx2()
+// desc: 8 samples per step
+//-----------------------------------------------------------------------------
+__attribute__(( target( "avx2" ) ))
+static void mix_avx2( float * out, const float * const * src,
+                      const float * gain, int count, long samples )
+{
+    long i;
+    int s = 0;
+
+    memset( out, 0, samples * sizeof(float) );
+
+    for( ; s + 4 <= count; s += 4 )
+    {
+        const float * a = src[s], * b = src[s+1], * c = src[s+2], * d = src[s+3];
+        __m256 ga = _mm256_set1_ps( gain[s] ), gb = _mm256_set1_ps( gain[s+1] );
+        __m256 gc = _mm256_set1_ps( gain[s+2] ), gd = _mm256_set1_ps( gain[s+3] );
+
+        for( i = 0; i + 8 <= samples; i += 8 )
+        {
+            __m256 acc = _mm256_loadu_ps( out + i );
+            acc = _mm256_add_ps( acc, _mm256_mul_ps( ga, _mm256_loadu_ps( a + i ) ) );
+            acc = _mm256_add_ps( acc, _mm256_mul_ps( gb, _mm256_loadu_ps( b + i ) ) );
+            acc = _mm256_add_ps( acc, _mm256_mul_ps( gc, _mm256_loadu_ps( c + i ) ) );
+            acc = _mm256_add_ps( acc, _mm256_mul_ps( gd, _mm256_loadu_ps( d + i ) ) );
+            _mm256_storeu_ps( out + i, acc );
+        }
+        for( ; i < samples; i++ )
+            out[i] += gain[s]*a[i] + gain[s+1]*b[i] + gain[s+2]*c[i] + gain[s+3]*d[i];
+    }
+
+    for( ; s < count; s++ )
+    {
+        const float * a = src[s];
+        __m256 ga = _mm256_set1_ps( gain[s] );
+
+        for( i = 0; i + 8 <= samples; i += 8 )
+            _mm256_storeu_ps( out + i, _mm256_add_ps( _mm256_loadu_ps( out + i ),
+                              _mm256_mul_ps( ga, _mm256_loadu_ps( a + i ) ) ) );
+        for( ; i < samples; i++ )
+            out[i] += gain[s] * a[i];
+    }
+
+    // avoid the AVX/SSE transition penalty in whatever runs next
+    _mm256_zeroupper();
+}
+#endif
+
+
+
+
+#ifdef MIX_NEON
+//-----------------------------------------------------------------------------
+// name: mix_neon()
+// desc: 4 samples per step
+//-----------------------------------------------------------------------------
+static void mix_neon( float * out, const float * const * src,
+                      const float * gain, int count, long samples )
+{
+    long i;
+    int s = 0;
+
+    memset( out, 0, samples * sizeof(float) );
+
+    for( ; s + 4 <= count; s += 4 )
+    {
+        const float * a = src[s], * b = src[s+1], * c = src[s+2], * d = src[s+3];
+
+        for( i = 0; i + 4 <= samples; i += 4 )
+        {
+            float32x4_t acc = vld1q_f32( out + i );
+            acc = vmlaq_n_f32( acc, vld1q_f32( a + i ), gain[s] );
+            acc = vmlaq_n_f32( acc, vld1q_f32( b + i ), gain[s+1] );
+            acc = vmlaq_n_f32( acc, vld1q_f32( c + i ), gain[s+2] );
+            acc = vmlaq_n_f32( acc, vld1q_f32( d + i ), gain[s+3] );
+            vst1q_f32( out + i, acc );
+        }
+        for( ; i < samples; i++ )
+            out[i] += gain[s]*a[i] + gain[s+1]*b[i] + gain[s+2]*c[i] + gain[s+3]*d[i];
+    }
+
+    for( ; s < count; s++ )
+    {
+        const float * a = src[s];
+
+        for( i = 0; i + 4 <= samples; i += 4 )
+            vst1q_f32( out + i, vmlaq_n_f32( vld1q_f32( out + i ), vld1q_f32( a + i ), gain[s] ) );
+        for( ; i < samples; i++ )
+            out[i] += gain[s] * a[i];
+    }
+}
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_init()
+// desc: build the kernel list for this cpu and pick the first one
+//-----------------------------------------------------------------------------
+void mix_init( void )
+{
+    int n = 0;
+
+#ifdef MIX_X86
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        g_kernels[n].name = "avx2"; g_kernels[n].func = mix_avx2; n++;
+    }
+    if( __builtin_cpu_supports( "sse2" ) )
+    {
+        g_kernels[n].name = "sse2"; g_kernels[n].func = mix_sse2; n++;
+    }
+#endif
+#ifdef MIX_NEON
+    g_kernels[n].name = "neon"; g_kernels[n].func = mix_neon; n++;
+#endif
+    g_kernels[n].name = "scalar"; g_kernels[n].func = mix_scalar; n++;
+
+    g_num_kernels = n;
+    g_mix_name = g_kernels[0].name;
+    g_mix = g_kernels[0].func;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_resolve()
+// desc: first call lands here if mix_init() was skipped
+//-----------------------------------------------------------------------------
+static void mix_resolve( float * out, const float * const * src,
+                         const float * gain, int count, long samples )
+{
+    mix_init();
+    g_mix( out, src, gain, count, samples );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_kernel_name()
+// desc: ...
+//-----------------------------------------------------------------------------
+const char * mix_kernel_name( void )
+{
+    return g_mix_name;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_kernels()
+// desc: ...
+//-----------------------------------------------------------------------------
+const mix_kernel * mix_kernels( int * count )
+{
+    if( g_num_kernels == 0 )
+        mix_init();
+
+    *count = g_num_kernels;
+    return g_kernels;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: mix_slices()
+// desc: sum the sources with the selected kernel
+//-----------------------------------------------------------------------------
+void mix_slices( float * out, const float * const * src,
+                 const float * gain, int count, long samples )
+{
+    g_mix( out, src, gain, count, samples );
+}
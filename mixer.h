@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+// name: mixer.h
+// desc: slice summing kernels
+//
+//   out[i] = sum over s of gain[s] * src[s][i]
+//
+//   the kernel is picked at runtime for the cpu we are on (AVX2 / SSE2 on
+//   x86, NEON on ARM) and falls back to plain C everywhere else.
+//-----------------------------------------------------------------------------
+#ifndef __MIXER_H__
+#define __MIXER_H__
+
+
+typedef void (* mix_func)( float * out, const float * const * src,
+                           const float * gain, int count, long samples );
+
+typedef struct {
+    const char * name;
+    mix_func func;
+} mix_kernel;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// pick the best kernel for this cpu, call once before the audio starts
+void mix_init( void );
+// name of the kernel mix_slices() is using
+const char * mix_kernel_name( void );
+// every kernel this cpu can run, best first
+const mix_kernel * mix_kernels( int * count );
+
+// sum count sources of samples floats each into out (out is overwritten)
+void mix_slices( float * out, const float * const * src,
+                 const float * gain, int count, long samples );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
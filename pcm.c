@@ -0,0 +1,462 @@
+//-----------------------------------------------------------------------------
+// name: pcm.c
+// desc: sample formats a file can be kept in, and their read kernels
+//
+//   24-bit samples are widened to left-justified 32-bit integers (the low
+//   byte zero) and scaled by 2^-31, which is exact, so no kernel needs a
+//   sign extension of its own.  the vector kernels read a little past the
+//   samples they convert in a step, their loops stop early enough for
+//   that to stay inside the frames they were given.
+//-----------------------------------------------------------------------------
+#include "pcm.h"
+#include <stdint.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+  #define PCM_X86 1
+  #include <immintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+  #define PCM_NEON 1
+  #include <arm_neon.h>
+#endif
+
+
+#define PCM16_SCALE             (1.0f / 32768.0f)
+#define PCM24_SCALE             (1.0f / 2147483648.0f)//of the left-justified value
+
+static void pcm16_resolve( float * out, const void * left, const void * right, long frames );
+static void pcm24_resolve( float * out, const void * left, const void * right, long frames );
+
+static pcm_kernel g_kernels[5];
+static int g_num_kernels = 0;
+static pcm_func g_int16 = pcm16_resolve;
+static pcm_func g_int24 = pcm24_resolve;
+static const char * g_pcm_name = "none";
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm24_sample()
+// desc: one packed sample, left-justified
+//-----------------------------------------------------------------------------
+static inline int32_t pcm24_sample( const uint8_t * p )
+{
+    return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm16_scalar() / pcm24_scalar()
+// desc: plain C kernels, also used for the tails of the vector kernels
+//-----------------------------------------------------------------------------
+static void pcm16_scalar( float * out, const void * left, const void * right, long frames )
+{
+    const int16_t * l = (const int16_t *)left, * r = (const int16_t *)right;
+    long i;
+
+    for( i = 0; i < frames; i++ )
+    {
+        out[2 * i] = l[i] * PCM16_SCALE;
+        out[2 * i + 1] = r[i] * PCM16_SCALE;
+    }
+}
+
+static void pcm24_scalar( float * out, const void * left, const void * right, long frames )
+{
+    const uint8_t * l = (const uint8_t *)left, * r = (const uint8_t *)right;
+    long i;
+
+    for( i = 0; i < frames; i++ )
+    {
+        out[2 * i] = pcm24_sample( l + 3 * i ) * PCM24_SCALE;
+        out[2 * i + 1] = pcm24_sample( r + 3 * i ) * PCM24_SCALE;
+    }
+}
+
+
+
+
+#ifdef PCM_X86
+//-----------------------------------------------------------------------------
+// name: pcm16_sse2()
+// desc: 8 frames per step
+//-----------------------------------------------------------------------------
+__attribute__(( target( "sse2" ) ))
+static void pcm16_sse2( float * out, const void * left, const void * right, long frames )
+{
+    const int16_t * l = (const int16_t *)left, * r = (const int16_t *)right;
+    __m128 scale = _mm_set1_ps( PCM16_SCALE );
+    long i;
+
+    for( i = 0; i + 8 <= frames; i += 8 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)(l + i) );
+        __m128i b = _mm_loadu_si128( (const __m128i *)(r + i) );
+        // the sample in the top half of each lane, shifted back down signed
+        __m128 a0 = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( a, a ), 16 ) );
+        __m128 a1 = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( a, a ), 16 ) );
+        __m128 b0 = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( b, b ), 16 ) );
+        __m128 b1 = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( b, b ), 16 ) );
+
+        a0 = _mm_mul_ps( a0, scale ); a1 = _mm_mul_ps( a1, scale );
+        b0 = _mm_mul_ps( b0, scale ); b1 = _mm_mul_ps( b1, scale );
+        _mm_storeu_ps( out + 2 * i, _mm_unpacklo_ps( a0, b0 ) );
+        _mm_storeu_ps( out + 2 * i + 4, _mm_unpackhi_ps( a0, b0 ) );
+        _mm_storeu_ps( out + 2 * i + 8, _mm_unpacklo_ps( a1, b1 ) );
+        _mm_storeu_ps( out + 2 * i + 12, _mm_unpackhi_ps( a1, b1 ) );
+    }
+    pcm16_scalar( out + 2 * i, l + i, r + i, frames - i );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm24_ssse3()
+// desc: 4 frames per step, a byte shuffle spreads 12 bytes over 4 lanes
+//-----------------------------------------------------------------------------
+__attribute__(( target( "ssse3" ) ))
+static void pcm24_ssse3( float * out, const void * left, const void * right, long frames )
+{
+    const uint8_t * l = (const uint8_t *)left, * r = (const uint8_t *)right;
+    const __m128i spread = _mm_setr_epi8( -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 );
+    __m128 scale = _mm_set1_ps( PCM24_SCALE );
+    long i;
+
+    // each step loads 16 bytes for the 12 it uses
+    for( i = 0; i + 6 <= frames; i += 4 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)(l + 3 * i) );
+        __m128i b = _mm_loadu_si128( (const __m128i *)(r + 3 * i) );
+        __m128 fa = _mm_mul_ps( _mm_cvtepi32_ps( _mm_shuffle_epi8( a, spread ) ), scale );
+        __m128 fb = _mm_mul_ps( _mm_cvtepi32_ps( _mm_shuffle_epi8( b, spread ) ), scale );
+
+        _mm_storeu_ps( out + 2 * i, _mm_unpacklo_ps( fa, fb ) );
+        _mm_storeu_ps( out + 2 * i + 4, _mm_unpackhi_ps( fa, fb ) );
+    }
+    pcm24_scalar( out + 2 * i, l + 3 * i, r + 3 * i, frames - i );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm16_avx2()
+// desc: 8 frames per step
+//-----------------------------------------------------------------------------
+__attribute__(( target( "avx2" ) ))
+static void pcm16_avx2( float * out, const void * left, const void * right, long frames )
+{
+    const int16_t * l = (const int16_t *)left, * r = (const int16_t *)right;
+    __m256 scale = _mm256_set1_ps( PCM16_SCALE );
+    long i;
+
+    for( i = 0; i + 8 <= frames; i += 8 )
+    {
+        __m256 a = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32(
+                       _mm_loadu_si128( (const __m128i *)(l + i) ) ) );
+        __m256 b = _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32(
+                       _mm_loadu_si128( (const __m128i *)(r + i) ) ) );
+        __m256 lo, hi;
+
+        a = _mm256_mul_ps( a, scale );
+        b = _mm256_mul_ps( b, scale );
+        // unpack works within 128-bit lanes: lo is frames 0 1 | 4 5, hi 2 3 | 6 7
+        lo = _mm256_unpacklo_ps( a, b );
+        hi = _mm256_unpackhi_ps( a, b );
+        _mm256_storeu_ps( out + 2 * i, _mm256_permute2f128_ps( lo, hi, 0x20 ) );
+        _mm256_storeu_ps( out + 2 * i + 8, _mm256_permute2f128_ps( lo, hi, 0x31 ) );
+    }
+    pcm16_scalar( out + 2 * i, l + i, r + i, frames - i );
+
+    // avoid the AVX/SSE transition penalty in whatever runs next
+    _mm256_zeroupper();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm24_avx2()
+// desc: 8 frames per step.  bytes 0-11 go to the low lane and 12-23 to the
+//       high one, then the same shuffle as pcm24_ssse3() in each
+//-----------------------------------------------------------------------------
+__attribute__(( target( "avx2" ) ))
+static void pcm24_avx2( float * out, const void * left, const void * right, long frames )
+{
+    const uint8_t * l = (const uint8_t *)left, * r = (const uint8_t *)right;
+    const __m256i lanes = _mm256_setr_epi32( 0, 1, 2, 3, 3, 4, 5, 6 );
+    const __m256i spread = _mm256_setr_epi8( -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+                                             -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 );
+    __m256 scale = _mm256_set1_ps( PCM24_SCALE );
+    long i;
+
+    // each step loads 32 bytes for the 24 it uses
+    for( i = 0; i + 11 <= frames; i += 8 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)(l + 3 * i) );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)(r + 3 * i) );
+        __m256 fa, fb, lo, hi;
+
+        a = _mm256_shuffle_epi8( _mm256_permutevar8x32_epi32( a, lanes ), spread );
+        b = _mm256_shuffle_epi8( _mm256_permutevar8x32_epi32( b, lanes ), spread );
+        fa = _mm256_mul_ps( _mm256_cvtepi32_ps( a ), scale );
+        fb = _mm256_mul_ps( _mm256_cvtepi32_ps( b ), scale );
+        lo = _mm256_unpacklo_ps( fa, fb );
+        hi = _mm256_unpackhi_ps( fa, fb );
+        _mm256_storeu_ps( out + 2 * i, _mm256_permute2f128_ps( lo, hi, 0x20 ) );
+        _mm256_storeu_ps( out + 2 * i + 8, _mm256_permute2f128_ps( lo, hi, 0x31 ) );
+    }
+    pcm24_scalar( out + 2 * i, l + 3 * i, r + 3 * i, frames - i );
+
+    // avoid the AVX/SSE transition penalty in whatever runs next
+    _mm256_zeroupper();
+}
+#endif
+
+
+
+
+#ifdef PCM_NEON
+//-----------------------------------------------------------------------------
+// name: pcm16_neon()
+// desc: 8 frames per step
+//-----------------------------------------------------------------------------
+static void pcm16_neon( float * out, const void * left, const void * right, long frames )
+{
+    const int16_t * l = (const int16_t *)left, * r = (const int16_t *)right;
+    long i;
+
+    for( i = 0; i + 8 <= frames; i += 8 )
+    {
+        int16x8_t a = vld1q_s16( l + i ), b = vld1q_s16( r + i );
+        float32x4x2_t lo, hi;
+
+        lo.val[0] = vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vget_low_s16( a ) ) ), PCM16_SCALE );
+        lo.val[1] = vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vget_low_s16( b ) ) ), PCM16_SCALE );
+        hi.val[0] = vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vget_high_s16( a ) ) ), PCM16_SCALE );
+        hi.val[1] = vmulq_n_f32( vcvtq_f32_s32( vmovl_s16( vget_high_s16( b ) ) ), PCM16_SCALE );
+        vst2q_f32( out + 2 * i, lo );
+        vst2q_f32( out + 2 * i + 8, hi );
+    }
+    pcm16_scalar( out + 2 * i, l + i, r + i, frames - i );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm24_neon_widen()
+// desc: 8 packed samples, de-interleaved by byte, into two left-justified
+//       quads of floats
+//-----------------------------------------------------------------------------
+static inline void pcm24_neon_widen( uint8x8x3_t p, float32x4_t * lo, float32x4_t * hi )
+{
+    // bytes 0 and 1 as one 16-bit value, byte 2 on its own
+    uint16x8_t low = vorrq_u16( vmovl_u8( p.val[0] ), vshll_n_u8( p.val[1], 8 ) );
+    uint16x8_t top = vmovl_u8( p.val[2] );
+    uint32x4_t a = vorrq_u32( vshll_n_u16( vget_low_u16( low ), 8 ),
+                              vshlq_n_u32( vmovl_u16( vget_low_u16( top ) ), 24 ) );
+    uint32x4_t b = vorrq_u32( vshll_n_u16( vget_high_u16( low ), 8 ),
+                              vshlq_n_u32( vmovl_u16( vget_high_u16( top ) ), 24 ) );
+
+    *lo = vmulq_n_f32( vcvtq_f32_s32( vreinterpretq_s32_u32( a ) ), PCM24_SCALE );
+    *hi = vmulq_n_f32( vcvtq_f32_s32( vreinterpretq_s32_u32( b ) ), PCM24_SCALE );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm24_neon()
+// desc: 8 frames per step
+//-----------------------------------------------------------------------------
+static void pcm24_neon( float * out, const void * left, const void * right, long frames )
+{
+    const uint8_t * l = (const uint8_t *)left, * r = (const uint8_t *)right;
+    long i;
+
+    for( i = 0; i + 8 <= frames; i += 8 )
+    {
+        float32x4x2_t lo, hi;
+
+        pcm24_neon_widen( vld3_u8( l + 3 * i ), &lo.val[0], &hi.val[0] );
+        pcm24_neon_widen( vld3_u8( r + 3 * i ), &lo.val[1], &hi.val[1] );
+        vst2q_f32( out + 2 * i, lo );
+        vst2q_f32( out + 2 * i + 8, hi );
+    }
+    pcm24_scalar( out + 2 * i, l + 3 * i, r + 3 * i, frames - i );
+}
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm_init()
+// desc: build the kernel list for this cpu and pick the first one
+//-----------------------------------------------------------------------------
+void pcm_init( void )
+{
+    int n = 0;
+
+#ifdef PCM_X86
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        g_kernels[n].name = "avx2"; g_kernels[n].int16 = pcm16_avx2;
+        g_kernels[n].int24 = pcm24_avx2; n++;
+    }
+    if( __builtin_cpu_supports( "ssse3" ) )
+    {
+        g_kernels[n].name = "ssse3"; g_kernels[n].int16 = pcm16_sse2;
+        g_kernels[n].int24 = pcm24_ssse3; n++;
+    }
+    if( __builtin_cpu_supports( "sse2" ) )
+    {
+        g_kernels[n].name = "sse2"; g_kernels[n].int16 = pcm16_sse2;
+        g_kernels[n].int24 = pcm24_scalar; n++;
+    }
+#endif
+#ifdef PCM_NEON
+    g_kernels[n].name = "neon"; g_kernels[n].int16 = pcm16_neon;
+    g_kernels[n].int24 = pcm24_neon; n++;
+#endif
+    g_kernels[n].name = "scalar"; g_kernels[n].int16 = pcm16_scalar;
+    g_kernels[n].int24 = pcm24_scalar; n++;
+
+    g_num_kernels = n;
+    g_pcm_name = g_kernels[0].name;
+    g_int16 = g_kernels[0].int16;
+    g_int24 = g_kernels[0].int24;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm16_resolve() / pcm24_resolve()
+// desc: first call lands here if pcm_init() was skipped
+//-----------------------------------------------------------------------------
+static void pcm16_resolve( float * out, const void * left, const void * right, long frames )
+{
+    pcm_init();
+    g_int16( out, left, right, frames );
+}
+
+static void pcm24_resolve( float * out, const void * left, const void * right, long frames )
+{
+    pcm_init();
+    g_int24( out, left, right, frames );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm_kernel_name()
+// desc: ...
+//-----------------------------------------------------------------------------
+const char * pcm_kernel_name( void )
+{
+    return g_pcm_name;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm_kernels()
+// desc: ...
+//-----------------------------------------------------------------------------
+const pcm_kernel * pcm_kernels( int * count )
+{
+    if( g_num_kernels == 0 )
+        pcm_init();
+
+    *count = g_num_kernels;
+    return g_kernels;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm_bytes() / pcm_format_name()
+// desc: ...
+//-----------------------------------------------------------------------------
+int pcm_bytes( pcmFormat format )
+{
+    return format == PCM_INT16 ? 2 : format == PCM_INT24 ? 3 : 4;
+}
+
+const char * pcm_format_name( pcmFormat format )
+{
+    return format == PCM_INT16 ? "16-bit" : format == PCM_INT24 ? "24-bit" : "float";
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm_pack()
+// desc: drops the bits below the format, which a source of that depth
+//       doesn't have
+//-----------------------------------------------------------------------------
+void pcm_pack( pcmFormat format, void * dst, const int * src, int step, long count )
+{
+    long i;
+
+    if( format == PCM_INT16 )
+    {
+        int16_t * d = (int16_t *)dst;
+        for( i = 0; i < count; i++ )
+            d[i] = (int16_t)(src[i * step] >> 16);
+    }
+    else if( format == PCM_INT24 )
+    {
+        uint8_t * d = (uint8_t *)dst;
+        for( i = 0; i < count; i++ )
+        {
+            uint32_t v = (uint32_t)src[i * step];
+            d[3 * i] = (uint8_t)(v >> 8);
+            d[3 * i + 1] = (uint8_t)(v >> 16);
+            d[3 * i + 2] = (uint8_t)(v >> 24);
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pcm_stereo()
+// desc: float needs no converting, only interleaving
+//-----------------------------------------------------------------------------
+void pcm_stereo( pcmFormat format, float * out, const void * left, const void * right,
+                 long frames )
+{
+    const float * l, * r;
+    long i;
+
+    if( format == PCM_INT16 )
+    {
+        g_int16( out, left, right, frames );
+        return;
+    }
+    if( format == PCM_INT24 )
+    {
+        g_int24( out, left, right, frames );
+        return;
+    }
+
+    l = (const float *)left;
+    r = (const float *)right;
+    for( i = 0; i < frames; i++ )
+    {
+        out[2 * i] = l[i];
+        out[2 * i + 1] = r[i];
+    }
+}
@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// name: pcm.h
+// desc: sample formats a file can be kept in, and their read kernels
+//
+//   PCM_FLOAT32 is the decoded float as libsndfile hands it over.  the
+//   packed integer formats take 2 or 3 bytes a sample instead of 4 and
+//   hold a 16 or 24-bit source exactly: they scale back to the very same
+//   floats.  reads turn a run of planar frames into interleaved stereo
+//   float with a kernel picked at runtime for the cpu we are on (AVX2 /
+//   SSSE3 / SSE2 on x86, NEON on ARM), plain C everywhere else.
+//-----------------------------------------------------------------------------
+#ifndef __PCM_H__
+#define __PCM_H__
+
+
+typedef enum {
+    PCM_FLOAT32,                // 4 bytes, native float
+    PCM_INT16,                  // 2 bytes, native signed short
+    PCM_INT24                   // 3 bytes, packed little endian
+} pcmFormat;
+
+// frames of left and right into out as interleaved stereo float
+typedef void (* pcm_func)( float * out, const void * left, const void * right, long frames );
+
+typedef struct {
+    const char * name;
+    pcm_func int16;
+    pcm_func int24;
+} pcm_kernel;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// pick the best kernels for this cpu, call once before the audio starts
+void pcm_init( void );
+// name of the kernel pcm_stereo() is using
+const char * pcm_kernel_name( void );
+// every kernel this cpu can run, best first
+const pcm_kernel * pcm_kernels( int * count );
+
+// bytes one sample takes, and a short name for printing
+int pcm_bytes( pcmFormat format );
+const char * pcm_format_name( pcmFormat format );
+
+// store count samples of 32-bit, left-justified integer audio (what
+// sf_readf_int() returns), taking every step-th one from src.  for the
+// integer formats only
+void pcm_pack( pcmFormat format, void * dst, const int * src, int step, long count );
+// frames from planar channels left and right into an interleaved stereo
+// buffer (left == right for mono).  any number of threads
+void pcm_stereo( pcmFormat format, float * out, const void * left, const void * right,
+                 long frames );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
@@ -0,0 +1,230 @@
+//-----------------------------------------------------------------------------
+// name: renderahead.c
+// desc: render one block ahead of the audio callback
+//
+//   each half of the buffer has a filled flag.  the thread renders the
+//   first block straight away and after that one block each time the
+//   callback uses one up, so it never gets more than a block ahead.
+//-----------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include "renderahead.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#ifdef __APPLE__
+  #include <dispatch/dispatch.h>
+#else
+  #include <semaphore.h>
+#endif
+
+#define AHEAD_STEREO            2
+
+
+struct renderAhead {
+    ahead_func render;
+    void * user;
+    unsigned long frames;       // frames per block
+    float * block[2];           // interleaved stereo
+    atomic_bool filled[2];
+    int readBlock;              // audio thread only
+    unsigned long readPos;      // frames of readBlock already played
+    pthread_t thread;
+#ifdef __APPLE__
+    dispatch_semaphore_t wake;
+#else
+    sem_t wake;
+#endif
+    atomic_bool quit;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ahead_post() / ahead_wait()
+// desc: ...
+//-----------------------------------------------------------------------------
+static void ahead_post( renderAhead * ahead )
+{
+#ifdef __APPLE__
+    dispatch_semaphore_signal( ahead->wake );
+#else
+    sem_post( &ahead->wake );
+#endif
+}
+
+static void ahead_wait( renderAhead * ahead )
+{
+#ifdef __APPLE__
+    dispatch_semaphore_wait( ahead->wake, DISPATCH_TIME_FOREVER );
+#else
+    while( sem_wait( &ahead->wake ) != 0 )
+        ;
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ahead_main()
+// desc: render thread, real-time priority if the system allows it
+//-----------------------------------------------------------------------------
+static void * ahead_main( void * arg )
+{
+    renderAhead * ahead = (renderAhead *)arg;
+    struct sched_param param;
+    int w = 0;
+
+    param.sched_priority = (sched_get_priority_min( SCHED_FIFO )
+                         + sched_get_priority_max( SCHED_FIFO )) / 2;
+    pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+
+    for( ;; )
+    {
+        if( !atomic_load_explicit( &ahead->filled[w], memory_order_acquire ) )
+        {
+            ahead->render( ahead->user, ahead->block[w], ahead->frames );
+            atomic_store_explicit( &ahead->filled[w], true, memory_order_release );
+            w ^= 1;
+        }
+        ahead_wait( ahead );
+        if( atomic_load_explicit( &ahead->quit, memory_order_acquire ) )
+            break;
+    }
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ahead_create()
+// desc: ...
+//-----------------------------------------------------------------------------
+renderAhead * ahead_create( ahead_func render, void * user, unsigned long frames )
+{
+    renderAhead * ahead = (renderAhead *)calloc( 1, sizeof(renderAhead) );
+
+    if( ahead == NULL )
+        return NULL;
+
+    ahead->render = render;
+    ahead->user = user;
+    ahead->frames = frames;
+    ahead->block[0] = (float *)calloc( 2 * frames * AHEAD_STEREO, sizeof(float) );
+    ahead->block[1] = ahead->block[0] != NULL ? ahead->block[0] + frames * AHEAD_STEREO : NULL;
+    atomic_init( &ahead->filled[0], false );
+    atomic_init( &ahead->filled[1], false );
+    atomic_init( &ahead->quit, false );
+    if( ahead->block[0] == NULL )
+    {
+        free( ahead );
+        return NULL;
+    }
+
+#ifdef __APPLE__
+    ahead->wake = dispatch_semaphore_create( 0 );
+    if( ahead->wake == NULL )
+    {
+        free( ahead->block[0] );
+        free( ahead );
+        return NULL;
+    }
+#else
+    if( sem_init( &ahead->wake, 0, 0 ) != 0 )
+    {
+        free( ahead->block[0] );
+        free( ahead );
+        return NULL;
+    }
+#endif
+
+    if( pthread_create( &ahead->thread, NULL, ahead_main, ahead ) != 0 )
+    {
+#ifdef __APPLE__
+        dispatch_release( ahead->wake );
+#else
+        sem_destroy( &ahead->wake );
+#endif
+        free( ahead->block[0] );
+        free( ahead );
+        return NULL;
+    }
+
+    return ahead;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ahead_free()
+// desc: ...
+//-----------------------------------------------------------------------------
+void ahead_free( renderAhead * ahead )
+{
+    if( ahead == NULL )
+        return;
+
+    atomic_store_explicit( &ahead->quit, true, memory_order_release );
+    ahead_post( ahead );
+    pthread_join( ahead->thread, NULL );
+
+#ifdef __APPLE__
+    dispatch_release( ahead->wake );
+#else
+    sem_destroy( &ahead->wake );
+#endif
+    free( ahead->block[0] );
+    free( ahead );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ahead_read()
+// desc: a block that isn't ready yet is played late rather than skipped,
+//       the gap is filled with silence
+//-----------------------------------------------------------------------------
+unsigned long ahead_read( renderAhead * ahead, float * out, unsigned long frames )
+{
+    unsigned long n;
+    int r;
+
+    while( frames > 0 )
+    {
+        r = ahead->readBlock;
+        if( !atomic_load_explicit( &ahead->filled[r], memory_order_acquire ) )
+        {
+            memset( out, 0, frames * AHEAD_STEREO * sizeof(float) );
+            return frames;
+        }
+
+        n = ahead->frames - ahead->readPos;
+        if( n > frames )
+            n = frames;
+        memcpy( out, ahead->block[r] + ahead->readPos * AHEAD_STEREO,
+                n * AHEAD_STEREO * sizeof(float) );
+        out += n * AHEAD_STEREO;
+        frames -= n;
+        ahead->readPos += n;
+
+        // used up: hand the half back and have the next block rendered
+        if( ahead->readPos == ahead->frames )
+        {
+            atomic_store_explicit( &ahead->filled[r], false, memory_order_release );
+            ahead->readBlock = r ^ 1;
+            ahead->readPos = 0;
+            ahead_post( ahead );
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+//-----------------------------------------------------------------------------
+// name: renderahead.h
+// desc: render one block ahead of the audio callback
+//
+//   a thread of its own renders the next block into the other half of a
+//   double buffer while the current one plays, so rendering gets a whole
+//   buffer period instead of whatever the callback leaves over, at the
+//   cost of one block of extra latency.  the callback only copies.
+//-----------------------------------------------------------------------------
+#ifndef __RENDERAHEAD_H__
+#define __RENDERAHEAD_H__
+
+
+typedef struct renderAhead renderAhead;
+
+// renders exactly frames frames of interleaved stereo into out
+typedef void (* ahead_func)( void * user, float * out, unsigned long frames );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// start the thread and render the first block; frames per block.  NULL on
+// failure
+renderAhead * ahead_create( ahead_func render, void * user, unsigned long frames );
+// stop and join the thread, ahead may be NULL
+void ahead_free( renderAhead * ahead );
+// audio thread: copy frames of finished audio into out, waking the thread
+// for each block used up.  returns the frames that weren't ready in time,
+// played as silence
+unsigned long ahead_read( renderAhead * ahead, float * out, unsigned long frames );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
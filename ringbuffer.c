@@ -0,0 +1,186 @@
+//-----------------------------------------------------------------------------
+// name: ringbuffer.c
+// desc: single-producer / single-consumer lock-free ring buffer
+//-----------------------------------------------------------------------------
+#include "ringbuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_init()
+// desc: allocate the ring, returns 0 on success
+//-----------------------------------------------------------------------------
+int rb_init( ringbuffer * rb, size_t elemSize, size_t count )
+{
+    // count has to be a power of 2 for the index masking to work
+    if( count == 0 || (count & (count - 1)) != 0 )
+        return -1;
+
+    rb->buffer = (char *)calloc( count, elemSize );
+    if( rb->buffer == NULL )
+        return -1;
+
+    rb->size = count;
+    rb->mask = count - 1;
+    rb->elemSize = elemSize;
+    atomic_init( &rb->writeIndex, 0 );
+    atomic_init( &rb->readIndex, 0 );
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_free()
+// desc: release the storage
+//-----------------------------------------------------------------------------
+void rb_free( ringbuffer * rb )
+{
+    free( rb->buffer );
+    rb->buffer = NULL;
+    rb->size = rb->mask = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_write_available()
+// desc: number of elements the producer can write without overrunning
+//-----------------------------------------------------------------------------
+size_t rb_write_available( ringbuffer * rb )
+{
+    size_t w = atomic_load_explicit( &rb->writeIndex, memory_order_relaxed );
+    size_t r = atomic_load_explicit( &rb->readIndex, memory_order_acquire );
+
+    return rb->size - (w - r);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_write()
+// desc: copy up to count elements in, returns the number written
+//-----------------------------------------------------------------------------
+size_t rb_write( ringbuffer * rb, const void * data, size_t count )
+{
+    size_t w = atomic_load_explicit( &rb->writeIndex, memory_order_relaxed );
+    size_t avail = rb_write_available( rb );
+    size_t first, offset;
+
+    if( count > avail )
+        count = avail;
+    if( count == 0 )
+        return 0;
+
+    // the region may wrap past the end of the buffer
+    offset = w & rb->mask;
+    first = rb->size - offset;
+    if( first > count )
+        first = count;
+
+    memcpy( rb->buffer + offset * rb->elemSize, data, first * rb->elemSize );
+    memcpy( rb->buffer, (const char *)data + first * rb->elemSize,
+            (count - first) * rb->elemSize );
+
+    // publish the data before the new index
+    atomic_store_explicit( &rb->writeIndex, w + count, memory_order_release );
+
+    return count;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_write_position()
+// desc: free-running count of elements written so far
+//-----------------------------------------------------------------------------
+size_t rb_write_position( ringbuffer * rb )
+{
+    return atomic_load_explicit( &rb->writeIndex, memory_order_relaxed );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_read_available()
+// desc: number of elements the consumer can read
+//-----------------------------------------------------------------------------
+size_t rb_read_available( ringbuffer * rb )
+{
+    size_t w = atomic_load_explicit( &rb->writeIndex, memory_order_acquire );
+    size_t r = atomic_load_explicit( &rb->readIndex, memory_order_relaxed );
+
+    return w - r;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_read()
+// desc: copy up to count elements out, returns the number read
+//-----------------------------------------------------------------------------
+size_t rb_read( ringbuffer * rb, void * data, size_t count )
+{
+    size_t r = atomic_load_explicit( &rb->readIndex, memory_order_relaxed );
+    size_t avail = rb_read_available( rb );
+    size_t first, offset;
+
+    if( count > avail )
+        count = avail;
+    if( count == 0 )
+        return 0;
+
+    offset = r & rb->mask;
+    first = rb->size - offset;
+    if( first > count )
+        first = count;
+
+    memcpy( data, rb->buffer + offset * rb->elemSize, first * rb->elemSize );
+    memcpy( (char *)data + first * rb->elemSize, rb->buffer,
+            (count - first) * rb->elemSize );
+
+    // hand the space back to the producer only after we are done copying
+    atomic_store_explicit( &rb->readIndex, r + count, memory_order_release );
+
+    return count;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_read_position()
+// desc: free-running count of elements consumed so far
+//-----------------------------------------------------------------------------
+size_t rb_read_position( ringbuffer * rb )
+{
+    return atomic_load_explicit( &rb->readIndex, memory_order_relaxed );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rb_advance_read()
+// desc: drop count elements without copying them (clamped to what's there)
+//-----------------------------------------------------------------------------
+void rb_advance_read( ringbuffer * rb, size_t count )
+{
+    size_t r = atomic_load_explicit( &rb->readIndex, memory_order_relaxed );
+    size_t avail = rb_read_available( rb );
+
+    if( count > avail )
+        count = avail;
+
+    atomic_store_explicit( &rb->readIndex, r + count, memory_order_release );
+}
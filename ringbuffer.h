@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+// name: ringbuffer.h
+// desc: single-producer / single-consumer lock-free ring buffer
+//
+//   one thread writes, one thread reads, nobody locks.  the read and write
+//   positions are free-running counters; the element count must be a power
+//   of 2 so they can be masked into the buffer.
+//-----------------------------------------------------------------------------
+#ifndef __RINGBUFFER_H__
+#define __RINGBUFFER_H__
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+
+typedef struct {
+    size_t size;                // capacity in elements, power of 2
+    size_t mask;                // size - 1
+    size_t elemSize;            // bytes per element
+    atomic_size_t writeIndex;   // only advanced by the producer
+    atomic_size_t readIndex;    // only advanced by the consumer
+    char *buffer;
+} ringbuffer;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// allocate storage for count elements, count MUST be a power of 2
+int rb_init( ringbuffer * rb, size_t elemSize, size_t count );
+void rb_free( ringbuffer * rb );
+
+// producer side
+size_t rb_write_available( ringbuffer * rb );
+size_t rb_write( ringbuffer * rb, const void * data, size_t count );
+size_t rb_write_position( ringbuffer * rb );
+
+// consumer side
+size_t rb_read_available( ringbuffer * rb );
+size_t rb_read( ringbuffer * rb, void * data, size_t count );
+size_t rb_read_position( ringbuffer * rb );
+void rb_advance_read( ringbuffer * rb, size_t count );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
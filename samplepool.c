@@ -0,0 +1,743 @@
+//-----------------------------------------------------------------------------
+// name: samplepool.c
+// desc: every sound file the slices can play, loaded in the background
+//
+//   the loader thread and the control thread share the entries under a
+//   mutex; the audio thread never takes it.  it sees an entry through two
+//   atomics, refs and store.  an eviction clears store first and only then
+//   looks at refs, while a reference is taken before store is read, so
+//   one of the two always sees the other and the store is put back.
+//
+//   a store taken out of an entry, evicted or swapped for a new file, is
+//   retired rather than freed.  the audio thread announces the epoch it
+//   saw when it starts a block and clears it when the block is done; every
+//   retirement moves the epoch on, so a store retired in epoch e is
+//   freed once the audio thread is between blocks or inside one that
+//   began after e, and can't be holding the old pointer.
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include "samplepool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sndfile.h>
+
+
+#define SPOOL_NAP               10000000//ns the loader waits between looks
+
+typedef enum {
+    SPOOL_QUEUED,               // added, not tried yet
+    SPOOL_READY,                // store is in
+    SPOOL_EVICTED,              // dropped, or never loaded for lack of room
+    SPOOL_FAILED                // couldn't be loaded, not tried again
+} spoolState;
+
+// path and header are the latest file asked for, which may not be the one
+// in store yet; the control thread changes them under the mutex
+typedef struct {
+    char * path;
+    dev_t dev;                  // what makes two paths the same file
+    ino_t ino;
+    long long length;           // frames
+    int channels;
+    pcmFormat format;           // what it will be kept in
+    unsigned gen;               // bumped by every spool_replace()
+    unsigned loadedGen;         // gen of the file in store
+    spoolState state;           // under the mutex
+    _Atomic(samplestore *) store;
+    atomic_llong frames;        // length of the file in store, or to be
+    atomic_int refs;            // slices playing this file
+    atomic_ullong used;         // pool clock when it was last let go of
+} spoolFile;
+
+// a store waiting for the audio thread to be done with it
+typedef struct spoolRetired {
+    samplestore * store;
+    unsigned long long epoch;
+    struct spoolRetired * next;
+} spoolRetired;
+
+struct samplePool {
+    size_t budget;
+    int mode;                   // STORE_FLOAT or STORE_COMPACT
+    spoolFile file[SPOOL_MAX_FILES];
+    atomic_int count;           // entries filled in, they never go away
+    atomic_ullong clock;
+    atomic_ullong epoch;
+    atomic_ullong reader;       // epoch << 1 | 1 inside a block, 0 between
+    spoolRetired * retired;     // loader only
+    pthread_mutex_t lock;
+    pthread_cond_t changed;     // a load finished or a file was added
+    bool quit;
+    pthread_t thread;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_decoded()
+// desc: bytes a file takes once loaded, streamed files stop at the budget
+//-----------------------------------------------------------------------------
+static size_t spool_decoded( const samplePool * sp, const spoolFile * f )
+{
+    size_t bytes = (size_t)f->length * (f->channels < STORE_MAX_CHANNELS ?
+                                        f->channels : STORE_MAX_CHANNELS) * pcm_bytes( f->format );
+
+    return bytes < sp->budget ? bytes : sp->budget;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_total()
+// desc: bytes in memory across the pool, under the mutex
+//-----------------------------------------------------------------------------
+static size_t spool_total( samplePool * sp )
+{
+    int n = atomic_load( &sp->count );
+    size_t total = 0;
+    int i;
+
+    for( i = 0; i < n; i++ )
+        if( sp->file[i].state == SPOOL_READY )
+            total += store_resident( atomic_load( &sp->file[i].store ) );
+
+    return total;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_next()
+// desc: the entry the loader should open next, under the mutex: a
+//       referenced file that isn't in, then a file to swap in, else a new
+//       one there is room for.  -1 if there is nothing to do
+//-----------------------------------------------------------------------------
+static int spool_next( samplePool * sp )
+{
+    int n = atomic_load( &sp->count );
+    size_t total = spool_total( sp );
+    int i;
+
+    for( i = 0; i < n; i++ )
+    {
+        spoolState state = sp->file[i].state;
+
+        if( (state == SPOOL_QUEUED || state == SPOOL_EVICTED) &&
+            atomic_load( &sp->file[i].refs ) > 0 )
+            return i;
+    }
+    for( i = 0; i < n; i++ )
+        if( sp->file[i].state == SPOOL_READY && sp->file[i].loadedGen != sp->file[i].gen )
+            return i;
+    for( i = 0; i < n; i++ )
+    {
+        if( sp->file[i].state != SPOOL_QUEUED )
+            continue;
+        if( total + spool_decoded( sp, &sp->file[i] ) <= sp->budget )
+            return i;
+        // loaded when a slice asks for it
+        sp->file[i].state = SPOOL_EVICTED;
+    }
+
+    return -1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_retire()
+// desc: hand a store that is no longer in any entry to spool_reclaim(),
+//       under the mutex.  the epoch moves on after the store left its
+//       entry, so a block that saw the new epoch can't have seen the store
+//-----------------------------------------------------------------------------
+static void spool_retire( samplePool * sp, samplestore * st )
+{
+    spoolRetired * r = (spoolRetired *)malloc( sizeof(spoolRetired) );
+
+    if( r == NULL )
+    {
+        // no way to wait, so wait for a block boundary here instead
+        unsigned long long e = atomic_fetch_add( &sp->epoch, 1 );
+        unsigned long long reader;
+
+        while( (reader = atomic_load( &sp->reader )) != 0 && (reader >> 1) <= e )
+            ;
+        store_free( st );
+        free( st );
+        return;
+    }
+    r->store = st;
+    r->epoch = atomic_fetch_add( &sp->epoch, 1 );
+    r->next = sp->retired;
+    sp->retired = r;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_reclaim()
+// desc: free the retired stores the audio thread is provably done with,
+//       under the mutex
+//-----------------------------------------------------------------------------
+static void spool_reclaim( samplePool * sp )
+{
+    spoolRetired ** link = &sp->retired;
+    spoolRetired * r;
+    unsigned long long reader = atomic_load( &sp->reader );
+
+    while( (r = *link) != NULL )
+    {
+        if( reader == 0 || (reader >> 1) > r->epoch )
+        {
+            *link = r->next;
+            store_free( r->store );
+            free( r->store );
+            free( r );
+        }
+        else
+            link = &r->next;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_evict()
+// desc: drop the least recently used unreferenced files until the pool is
+//       within its budget, under the mutex
+//-----------------------------------------------------------------------------
+static void spool_evict( samplePool * sp )
+{
+    int n = atomic_load( &sp->count );
+    size_t total = spool_total( sp );
+    unsigned long long oldest;
+    samplestore * st;
+    bool tried[SPOOL_MAX_FILES] = { false };
+    int i, victim;
+
+    while( total > sp->budget )
+    {
+        victim = -1;
+        oldest = 0;
+        for( i = 0; i < n; i++ )
+        {
+            spoolFile * f = &sp->file[i];
+
+            if( f->state != SPOOL_READY || tried[i] || atomic_load( &f->refs ) > 0 )
+                continue;
+            if( victim < 0 || atomic_load( &f->used ) < oldest )
+            {
+                victim = i;
+                oldest = atomic_load( &f->used );
+            }
+        }
+        if( victim < 0 )
+            return;
+        tried[victim] = true;
+
+        // a slice may have taken a reference since; if so it keeps the file
+        st = atomic_exchange( &sp->file[victim].store, NULL );
+        if( atomic_load( &sp->file[victim].refs ) > 0 )
+        {
+            atomic_store( &sp->file[victim].store, st );
+            continue;
+        }
+
+        total -= store_resident( st );
+        spool_retire( sp, st );
+        sp->file[victim].state = SPOOL_EVICTED;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_publish()
+// desc: put a store the loader opened into its entry, under the mutex.
+//       a store for a file that has been replaced while it loaded is
+//       thrown away.  whatever it takes the place of is retired
+//-----------------------------------------------------------------------------
+static void spool_publish( samplePool * sp, int i, samplestore * st, unsigned gen )
+{
+    spoolFile * f = &sp->file[i];
+    samplestore * old;
+
+    if( gen != f->gen )
+    {
+        if( st != NULL )
+        {
+            store_free( st );
+            free( st );
+        }
+        return;
+    }
+    if( st == NULL )
+    {
+        fprintf( stderr, "samplepool: could not load %s\n", f->path );
+        // a swap that fails leaves the old file playing
+        if( f->state == SPOOL_READY )
+            f->loadedGen = gen;
+        else
+            f->state = SPOOL_FAILED;
+        return;
+    }
+
+    old = atomic_exchange( &f->store, st );
+    atomic_store( &f->frames, st->frames );
+    f->loadedGen = gen;
+    f->state = SPOOL_READY;
+    if( old != NULL )
+        spool_retire( sp, old );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_main()
+// desc: loader thread.  opening a file can take seconds, so the mutex is
+//       let go of meanwhile and only held to publish the result
+//-----------------------------------------------------------------------------
+static void * spool_main( void * arg )
+{
+    samplePool * sp = (samplePool *)arg;
+    struct timespec until;
+    samplestore * st;
+    char * path;
+    unsigned gen;
+    int i;
+
+    pthread_mutex_lock( &sp->lock );
+    while( !sp->quit )
+    {
+        i = spool_next( sp );
+        if( i >= 0 )
+        {
+            gen = sp->file[i].gen;
+            path = strdup( sp->file[i].path );
+            pthread_mutex_unlock( &sp->lock );
+            st = path != NULL ? (samplestore *)malloc( sizeof(samplestore) ) : NULL;
+            if( st != NULL && store_open( st, path, sp->budget, sp->mode ) != 0 )
+            {
+                free( st );
+                st = NULL;
+            }
+            free( path );
+            pthread_mutex_lock( &sp->lock );
+
+            spool_publish( sp, i, st, gen );
+            spool_evict( sp );
+            spool_reclaim( sp );
+            pthread_cond_broadcast( &sp->changed );
+            continue;
+        }
+
+        spool_evict( sp );
+        spool_reclaim( sp );
+
+        // references and blocks change without a signal, so look again
+        // now and then
+        clock_gettime( CLOCK_REALTIME, &until );
+        until.tv_nsec += SPOOL_NAP;
+        if( until.tv_nsec >= 1000000000 )
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait( &sp->changed, &sp->lock, &until );
+    }
+    pthread_mutex_unlock( &sp->lock );
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_create()
+// desc: ...
+//-----------------------------------------------------------------------------
+samplePool * spool_create( size_t budget, int mode )
+{
+    samplePool * sp = (samplePool *)calloc( 1, sizeof(samplePool) );
+    int i;
+
+    if( sp == NULL )
+        return NULL;
+
+    sp->budget = budget;
+    sp->mode = mode;
+    for( i = 0; i < SPOOL_MAX_FILES; i++ )
+    {
+        atomic_init( &sp->file[i].store, NULL );
+        atomic_init( &sp->file[i].frames, 0 );
+        atomic_init( &sp->file[i].refs, 0 );
+        atomic_init( &sp->file[i].used, 0 );
+    }
+    atomic_init( &sp->count, 0 );
+    atomic_init( &sp->clock, 0 );
+    atomic_init( &sp->epoch, 0 );
+    atomic_init( &sp->reader, 0 );
+
+    if( pthread_mutex_init( &sp->lock, NULL ) != 0 )
+    {
+        free( sp );
+        return NULL;
+    }
+    if( pthread_cond_init( &sp->changed, NULL ) != 0 )
+    {
+        pthread_mutex_destroy( &sp->lock );
+        free( sp );
+        return NULL;
+    }
+    if( pthread_create( &sp->thread, NULL, spool_main, sp ) != 0 )
+    {
+        pthread_cond_destroy( &sp->changed );
+        pthread_mutex_destroy( &sp->lock );
+        free( sp );
+        return NULL;
+    }
+
+    return sp;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_free()
+// desc: the audio thread must be stopped by now, so nothing retired needs
+//       waiting for
+//-----------------------------------------------------------------------------
+void spool_free( samplePool * sp )
+{
+    spoolRetired * r;
+    samplestore * st;
+    int i;
+
+    if( sp == NULL )
+        return;
+
+    pthread_mutex_lock( &sp->lock );
+    sp->quit = true;
+    pthread_cond_broadcast( &sp->changed );
+    pthread_mutex_unlock( &sp->lock );
+    pthread_join( sp->thread, NULL );
+
+    for( i = 0; i < atomic_load( &sp->count ); i++ )
+    {
+        st = atomic_load( &sp->file[i].store );
+        if( st != NULL )
+        {
+            store_free( st );
+            free( st );
+        }
+        free( sp->file[i].path );
+    }
+    while( (r = sp->retired) != NULL )
+    {
+        sp->retired = r->next;
+        store_free( r->store );
+        free( r->store );
+        free( r );
+    }
+    pthread_cond_destroy( &sp->changed );
+    pthread_mutex_destroy( &sp->lock );
+    free( sp );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_header()
+// desc: what a file is and what its header says, without decoding it;
+//       path is copied.  -1 if it can't be read or is empty
+//-----------------------------------------------------------------------------
+static int spool_header( const samplePool * sp, spoolFile * f, const char * path )
+{
+    struct stat sb;
+    SNDFILE * file;
+    SF_INFO info;
+
+    if( stat( path, &sb ) != 0 )
+        return -1;
+    memset( &info, 0, sizeof(info) );
+    file = sf_open( path, SFM_READ, &info );
+    if( file == NULL )
+        return -1;
+    sf_close( file );
+    // nothing to play, and slices scale their start by the length
+    if( info.frames <= 0 || info.channels < 1 )
+        return -1;
+
+    f->path = strdup( path );
+    if( f->path == NULL )
+        return -1;
+    f->dev = sb.st_dev;
+    f->ino = sb.st_ino;
+    f->length = (long long)info.frames;
+    f->channels = info.channels;
+    f->format = store_format( info.format, sp->mode );
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_find()
+// desc: the entry already holding path's file, -1 if none; under the mutex
+//-----------------------------------------------------------------------------
+static int spool_find( samplePool * sp, const char * path )
+{
+    struct stat sb;
+    int i, n = atomic_load( &sp->count );
+
+    if( stat( path, &sb ) != 0 )
+        return -1;
+    for( i = 0; i < n; i++ )
+        if( sp->file[i].dev == sb.st_dev && sp->file[i].ino == sb.st_ino )
+            return i;
+
+    return -1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_add()
+// desc: only the header is read here, the loader does the rest
+//-----------------------------------------------------------------------------
+int spool_add( samplePool * sp, const char * path )
+{
+    spoolFile header;
+    spoolFile * f;
+    int i, n;
+
+    pthread_mutex_lock( &sp->lock );
+    i = spool_find( sp, path );
+    n = atomic_load( &sp->count );
+    pthread_mutex_unlock( &sp->lock );
+    if( i >= 0 )
+        return i;
+    if( n == SPOOL_MAX_FILES || spool_header( sp, &header, path ) != 0 )
+        return -1;
+
+    // nobody else looks past count, so the entry can be filled in unlocked
+    f = &sp->file[n];
+    f->path = header.path;
+    f->dev = header.dev;
+    f->ino = header.ino;
+    f->length = header.length;
+    f->channels = header.channels;
+    f->format = header.format;
+    f->gen = f->loadedGen = 0;
+    f->state = SPOOL_QUEUED;
+    atomic_store( &f->frames, header.length );
+    atomic_store( &f->used, atomic_fetch_add( &sp->clock, 1 ) );
+
+    pthread_mutex_lock( &sp->lock );
+    atomic_store_explicit( &sp->count, n + 1, memory_order_release );
+    pthread_cond_broadcast( &sp->changed );
+    pthread_mutex_unlock( &sp->lock );
+
+    return n;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_replace()
+// desc: a loaded file keeps playing until the new one is in; one that
+//       isn't loaded just gets the new path
+//-----------------------------------------------------------------------------
+int spool_replace( samplePool * sp, int file, const char * path )
+{
+    spoolFile header;
+    spoolFile * f;
+
+    if( file < 0 || file >= spool_count( sp ) || spool_header( sp, &header, path ) != 0 )
+        return -1;
+
+    pthread_mutex_lock( &sp->lock );
+    f = &sp->file[file];
+    free( f->path );
+    f->path = header.path;
+    f->dev = header.dev;
+    f->ino = header.ino;
+    f->length = header.length;
+    f->channels = header.channels;
+    f->format = header.format;
+    f->gen++;
+    if( f->state != SPOOL_READY )
+    {
+        f->state = SPOOL_QUEUED;
+        atomic_store( &f->frames, header.length );
+    }
+    pthread_cond_broadcast( &sp->changed );
+    pthread_mutex_unlock( &sp->lock );
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_sync()
+// desc: the mutex is kept while the pagers catch up so the loader can't
+//       swap a store out from under store_sync()
+//-----------------------------------------------------------------------------
+int spool_sync( samplePool * sp )
+{
+    int i, n, pending, result;
+
+    pthread_mutex_lock( &sp->lock );
+    do
+    {
+        n = atomic_load( &sp->count );
+        pending = 0;
+        result = 0;
+        for( i = 0; i < n; i++ )
+        {
+            if( atomic_load( &sp->file[i].refs ) == 0 )
+                continue;
+            if( sp->file[i].state == SPOOL_FAILED )
+                result = -1;
+            else if( sp->file[i].state != SPOOL_READY || sp->file[i].loadedGen != sp->file[i].gen )
+                pending = 1;
+        }
+        if( pending )
+            pthread_cond_wait( &sp->changed, &sp->lock );
+    } while( pending );
+
+    for( i = 0; i < n; i++ )
+        if( atomic_load( &sp->file[i].refs ) > 0 && sp->file[i].state == SPOOL_READY )
+            store_sync( atomic_load( &sp->file[i].store ) );
+    pthread_mutex_unlock( &sp->lock );
+
+    return result;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_count() / spool_name() / spool_frames()
+// desc: ...
+//-----------------------------------------------------------------------------
+int spool_count( const samplePool * sp )
+{
+    return atomic_load_explicit( &sp->count, memory_order_acquire );
+}
+
+const char * spool_name( const samplePool * sp, int file )
+{
+    return sp->file[file].path;
+}
+
+long long spool_frames( samplePool * sp, int file )
+{
+    return atomic_load_explicit( &sp->file[file].frames, memory_order_relaxed );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_resident()
+// desc: ...
+//-----------------------------------------------------------------------------
+size_t spool_resident( samplePool * sp, int file )
+{
+    size_t bytes = 0;
+
+    pthread_mutex_lock( &sp->lock );
+    if( sp->file[file].state == SPOOL_READY )
+        bytes = store_resident( atomic_load( &sp->file[file].store ) );
+    pthread_mutex_unlock( &sp->lock );
+
+    return bytes;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_format()
+// desc: ...
+//-----------------------------------------------------------------------------
+pcmFormat spool_format( samplePool * sp, int file )
+{
+    pcmFormat format;
+
+    pthread_mutex_lock( &sp->lock );
+    if( sp->file[file].state == SPOOL_READY )
+        format = atomic_load( &sp->file[file].store )->format;
+    else
+        format = sp->file[file].format;
+    pthread_mutex_unlock( &sp->lock );
+
+    return format;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_ref() / spool_unref() / spool_store()
+// desc: ...
+//-----------------------------------------------------------------------------
+void spool_ref( samplePool * sp, int file )
+{
+    atomic_fetch_add( &sp->file[file].refs, 1 );
+}
+
+void spool_unref( samplePool * sp, int file )
+{
+    atomic_store_explicit( &sp->file[file].used,
+                           atomic_fetch_add_explicit( &sp->clock, 1, memory_order_relaxed ),
+                           memory_order_relaxed );
+    atomic_fetch_sub( &sp->file[file].refs, 1 );
+}
+
+samplestore * spool_store( samplePool * sp, int file )
+{
+    return atomic_load( &sp->file[file].store );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: spool_enter() / spool_leave()
+// desc: the epoch is announced before any store is read, so a store
+//       retired before the announcement can't be the one read
+//-----------------------------------------------------------------------------
+void spool_enter( samplePool * sp )
+{
+    atomic_store( &sp->reader, atomic_load( &sp->epoch ) << 1 | 1 );
+}
+
+void spool_leave( samplePool * sp )
+{
+    atomic_store( &sp->reader, 0 );
+}
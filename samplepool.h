@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// name: samplepool.h
+// desc: every sound file the slices can play, loaded in the background
+//
+//   files are added by path and get a fixed index; a file added twice,
+//   under any name, is the same entry.  a loader thread opens each one
+//   into a samplestore off the audio thread.  slices hold a reference to
+//   the file they play, and while the pool is over its memory budget the
+//   loader drops the least recently played files nobody references; one
+//   is loaded again when a slice goes back to it.  the audio thread only
+//   touches atomics: it never waits for a load or an eviction, a file that
+//   isn't in yet plays as silence.
+//
+//   a file can be replaced while it plays: the new one is loaded in the
+//   background and swapped in with one atomic store, and the old one is
+//   freed once the audio thread has provably stopped reading it.
+//-----------------------------------------------------------------------------
+#ifndef __SAMPLEPOOL_H__
+#define __SAMPLEPOOL_H__
+
+#include <stddef.h>
+#include "samplestore.h"
+
+
+#define SPOOL_MAX_FILES         64
+
+typedef struct samplePool samplePool;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// start the loader; files are opened with budget bytes each, in mode (see
+// store_load()), and the pool evicts down to budget bytes in total.  NULL
+// on failure
+samplePool * spool_create( size_t budget, int mode );
+// stop the loader and free every file
+void spool_free( samplePool * sp );
+
+// control thread: add a file and queue it for loading, returns its index
+// (an earlier one if it is already in the pool) or -1 if it can't be read
+// or has no frames
+int spool_add( samplePool * sp, const char * path );
+// control thread: load path in the background and swap it in for file,
+// the old file plays until then.  -1 if path can't be read or is empty
+int spool_replace( samplePool * sp, int file, const char * path );
+// control thread: wait until every referenced file is loaded (and swapped
+// in), and every streamed one has the pages it wants; -1 if one failed
+int spool_sync( samplePool * sp );
+
+// any thread: files added so far
+int spool_count( const samplePool * sp );
+// control thread: the path last given for a file
+const char * spool_name( const samplePool * sp, int file );
+// any thread: frames in the file, changes when a replacement is swapped in
+long long spool_frames( samplePool * sp, int file );
+// control thread: bytes of the file's decoded audio in memory, 0 if not in
+size_t spool_resident( samplePool * sp, int file );
+// control thread: the format the file's audio is kept in
+pcmFormat spool_format( samplePool * sp, int file );
+
+// audio thread: take or drop a slice's reference to a file.  a referenced
+// file is never evicted and is loaded if it isn't in
+void spool_ref( samplePool * sp, int file );
+void spool_unref( samplePool * sp, int file );
+// audio thread: the file's audio while a reference is held, NULL until
+// it is loaded.  only between spool_enter() and spool_leave()
+samplestore * spool_store( samplePool * sp, int file );
+// audio thread: bracket each block that uses spool_store(); stores aren't
+// freed while a block that may have seen them is running.  one thread
+// at a time
+void spool_enter( samplePool * sp );
+void spool_leave( samplePool * sp );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
@@ -0,0 +1,1091 @@
+//-----------------------------------------------------------------------------
+// name: samplestore.c
+// desc: decoded, in-memory copy of a sound file shared by all slices
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include "samplestore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sndfile.h>
+
+
+#define STORE_CHUNK             4096
+#define STORE_CACHE_MAGIC       "SLICEPCM"
+#define STORE_CACHE_VERSION     2
+#define STORE_CACHE_HEADER      4096//bytes before the first channel
+#define STORE_CACHE_NAME        "slicesampler"//directory under $XDG_CACHE_HOME
+#define STORE_HASH_SPAN         65536//bytes hashed at each of 3 points
+#define STORE_PAGES_PER_PASS    8//loads before the pager looks at the wants again
+#define STORE_PAGER_NAP         5000000//ns the pager sleeps with nothing to do
+#define STORE_READER_NAP        50000//ns between checks for readers to leave
+
+// first bytes of a cache file, the rest of its header page is zero
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    uint32_t samplerate;
+    uint32_t format;            // pcmFormat of the channels
+    uint64_t frames;
+    uint64_t stride;            // bytes from one channel to the next
+    uint64_t source;            // store_hash() of the file it came from
+} cacheHeader;
+
+// one reader's loop, written by the renderer and read by the pager
+typedef struct {
+    atomic_llong start;
+    atomic_llong frames;
+    atomic_llong position;
+} storeWant;
+
+struct storePager {
+    SNDFILE * file;             // pager thread only
+    int fileChannels;
+    void * chunk;               // one interleaved page straight from the file
+    long long numPages;
+    _Atomic(char *) * table;    // page -> planar frames, NULL if not in
+    long long * stamp;          // page -> last pass that wanted it
+    long long * order;          // pages wanted this pass, most urgent first
+    int maxPages;               // pages the budget has room for
+    char * memory;              // maxPages buffers of channels * page frames
+    long long * holds;          // buffer -> page it holds, -1 if free
+    storeWant want[STORE_MAX_WANTS];
+    atomic_int readers;         // store_read_stereo() calls in progress
+    atomic_int resident;        // pages in
+    atomic_ullong misses;
+    atomic_llong passes;        // passes started
+    atomic_llong idlePass;      // last pass that found nothing to load
+    atomic_int syncing;         // store_sync() calls waiting on the pager
+    atomic_bool quit;
+    long long pass;
+    pthread_t thread;
+};
+
+
+static int store_decode( samplestore * st, const char * path, pcmFormat format );
+
+// store_cache_dir(), NULL for the default
+static char * g_cacheDir = NULL;
+static void pager_free( storePager * pg );
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_alloc()
+// desc: aligned allocation for one planar channel
+//-----------------------------------------------------------------------------
+static void * store_alloc( long long frames, int sampleBytes )
+{
+    size_t bytes = (size_t)frames * sampleBytes;
+
+    // aligned_alloc wants a multiple of the alignment
+    bytes = (bytes + STORE_ALIGN - 1) & ~(size_t)(STORE_ALIGN - 1);
+    if( bytes == 0 )
+        bytes = STORE_ALIGN;
+
+    return aligned_alloc( STORE_ALIGN, bytes );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_stride()
+// desc: bytes one channel takes in a cache file
+//-----------------------------------------------------------------------------
+static uint64_t store_stride( long long frames, int sampleBytes )
+{
+    uint64_t bytes = (uint64_t)frames * sampleBytes;
+
+    return (bytes + STORE_ALIGN - 1) & ~(uint64_t)(STORE_ALIGN - 1);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_hash()
+// desc: fnv-1a over the source's size, modification time and 64k from its
+//       start, middle and end, enough to notice an edited or replaced file
+//       without reading all of it.  0 if the file can't be read
+//-----------------------------------------------------------------------------
+static uint64_t store_hash( const char * path )
+{
+    uint64_t hash = 14695981039346656037ull;
+    unsigned char * span;
+    struct stat sb;
+    uint64_t meta[2];
+    off_t offset[3];
+    ssize_t got;
+    size_t i;
+    int fd, k;
+
+    fd = open( path, O_RDONLY );
+    if( fd < 0 )
+        return 0;
+    span = (unsigned char *)malloc( STORE_HASH_SPAN );
+    if( span == NULL || fstat( fd, &sb ) != 0 )
+    {
+        free( span );
+        close( fd );
+        return 0;
+    }
+
+    meta[0] = (uint64_t)sb.st_size;
+    meta[1] = (uint64_t)sb.st_mtime;
+    for( i = 0; i < sizeof(meta); i++ )
+        hash = (hash ^ ((unsigned char *)meta)[i]) * 1099511628211ull;
+
+    offset[0] = 0;
+    offset[1] = sb.st_size / 2;
+    offset[2] = sb.st_size > STORE_HASH_SPAN ? sb.st_size - STORE_HASH_SPAN : 0;
+    for( k = 0; k < 3; k++ )
+    {
+        got = pread( fd, span, STORE_HASH_SPAN, offset[k] );
+        for( i = 0; got > 0 && i < (size_t)got; i++ )
+            hash = (hash ^ span[i]) * 1099511628211ull;
+    }
+
+    free( span );
+    close( fd );
+
+    return hash != 0 ? hash : 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_prefault()
+// desc: read one byte of every page so a cold cache file comes in from
+//       disk here, on the loading thread, and not as page faults in the
+//       first blocks that play it
+//-----------------------------------------------------------------------------
+static void store_prefault( const void * map, size_t bytes )
+{
+    const volatile char * p = (const volatile char *)map;
+    size_t page = (size_t)sysconf( _SC_PAGESIZE );
+    size_t i;
+
+    for( i = 0; i < bytes; i += page )
+        (void)p[i];
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_map()
+// desc: map a cache file if it matches the source and holds format,
+//       returns 0 on success
+//-----------------------------------------------------------------------------
+static int store_map( samplestore * st, const char * cachePath, uint64_t source,
+                      pcmFormat format )
+{
+    const cacheHeader * h;
+    struct stat sb;
+    void * map;
+    int fd, c;
+
+    fd = open( cachePath, O_RDONLY );
+    if( fd < 0 )
+        return -1;
+    if( fstat( fd, &sb ) != 0 || sb.st_size < STORE_CACHE_HEADER )
+    {
+        close( fd );
+        return -1;
+    }
+
+    map = mmap( NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED )
+        return -1;
+
+    h = (const cacheHeader *)map;
+    if( memcmp( h->magic, STORE_CACHE_MAGIC, sizeof(h->magic) ) != 0 ||
+        h->version != STORE_CACHE_VERSION || h->source != source ||
+        h->format != (uint32_t)format ||
+        h->channels < 1 || h->channels > STORE_MAX_CHANNELS ||
+        h->stride != store_stride( (long long)h->frames, pcm_bytes( format ) ) ||
+        (uint64_t)sb.st_size < STORE_CACHE_HEADER + h->channels * h->stride )
+    {
+        munmap( map, (size_t)sb.st_size );
+        return -1;
+    }
+
+    st->map = map;
+    st->mapBytes = (size_t)sb.st_size;
+    st->channels = (int)h->channels;
+    st->samplerate = (int)h->samplerate;
+    st->frames = (long long)h->frames;
+    st->format = format;
+    for( c = 0; c < st->channels; c++ )
+        st->data[c] = (char *)map + STORE_CACHE_HEADER + c * h->stride;
+
+    // the audio thread mustn't be the first to touch a page: ask for the
+    // whole file at once so the reads overlap, then wait for it
+    posix_madvise( map, st->mapBytes, POSIX_MADV_WILLNEED );
+    store_prefault( map, st->mapBytes );
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_cache_dir()
+// desc: ...
+//-----------------------------------------------------------------------------
+void store_cache_dir( const char * dir )
+{
+    free( g_cacheDir );
+    g_cacheDir = dir != NULL ? strdup( dir ) : NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_cache_path()
+// desc: where the cache of path goes, NULL if caching is off.  the name is
+//       the file's own plus a hash of its full path, so two files of the
+//       same name in different folders don't share one
+//-----------------------------------------------------------------------------
+static char * store_cache_path( const char * path )
+{
+    uint64_t hash = 14695981039346656037ull;
+    const char * home, * base;
+    char * dir, * cachePath, cwd[4096];
+    size_t length, i;
+
+    if( g_cacheDir != NULL && g_cacheDir[0] == '\0' )
+        return NULL;
+
+    // $XDG_CACHE_HOME only counts if it is absolute
+    if( g_cacheDir != NULL )
+        dir = strdup( g_cacheDir );
+    else if( (home = getenv( "XDG_CACHE_HOME" )) != NULL && home[0] == '/' )
+    {
+        length = strlen( home ) + sizeof(STORE_CACHE_NAME) + 1;
+        if( (dir = (char *)malloc( length )) != NULL )
+            snprintf( dir, length, "%s/%s", home, STORE_CACHE_NAME );
+    }
+    else if( (home = getenv( "HOME" )) != NULL && home[0] != '\0' )
+    {
+        length = strlen( home ) + sizeof(STORE_CACHE_NAME) + 8;
+        if( (dir = (char *)malloc( length )) != NULL )
+            snprintf( dir, length, "%s/.cache/%s", home, STORE_CACHE_NAME );
+    }
+    else
+        return NULL;
+    if( dir == NULL )
+        return NULL;
+
+    // a relative path is hashed after the directory it is relative to
+    if( path[0] != '/' && getcwd( cwd, sizeof(cwd) ) != NULL )
+    {
+        for( i = 0; cwd[i] != '\0'; i++ )
+            hash = (hash ^ (unsigned char)cwd[i]) * 1099511628211ull;
+        hash = (hash ^ '/') * 1099511628211ull;
+    }
+    for( i = 0; path[i] != '\0'; i++ )
+        hash = (hash ^ (unsigned char)path[i]) * 1099511628211ull;
+    base = strrchr( path, '/' ) != NULL ? strrchr( path, '/' ) + 1 : path;
+
+    length = strlen( dir ) + strlen( base ) + 18 + sizeof(STORE_CACHE_SUFFIX);
+    cachePath = (char *)malloc( length );
+    if( cachePath != NULL )
+        snprintf( cachePath, length, "%s/%s-%016llx%s", dir, base,
+                  (unsigned long long)hash, STORE_CACHE_SUFFIX );
+    free( dir );
+
+    return cachePath;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_make_dirs()
+// desc: create every directory leading up to a file, ones that are there
+//       already are fine
+//-----------------------------------------------------------------------------
+static void store_make_dirs( char * filePath )
+{
+    char * slash;
+
+    for( slash = strchr( filePath + 1, '/' ); slash != NULL; slash = strchr( slash + 1, '/' ) )
+    {
+        *slash = '\0';
+        mkdir( filePath, 0755 );
+        *slash = '/';
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_write_cache()
+// desc: write the decoded channels out under a temporary name and rename
+//       it into place, so a reader never maps half a file.  failing to
+//       write the cache is not an error, the next load just decodes again
+//-----------------------------------------------------------------------------
+static void store_write_cache( const samplestore * st, const char * cachePath, uint64_t source )
+{
+    char header[STORE_CACHE_HEADER];
+    cacheHeader * h = (cacheHeader *)header;
+    size_t length = strlen( cachePath );
+    char * tmpPath = (char *)malloc( length + 8 );
+    uint64_t stride = store_stride( st->frames, pcm_bytes( st->format ) );
+    FILE * out;
+    int fd, c, ok;
+
+    if( tmpPath == NULL )
+        return;
+    memcpy( tmpPath, cachePath, length );
+    memcpy( tmpPath + length, ".XXXXXX", 8 );
+    store_make_dirs( tmpPath );
+    fd = mkstemp( tmpPath );
+    if( fd < 0 )
+    {
+        free( tmpPath );
+        return;
+    }
+    fchmod( fd, 0644 );
+    out = fdopen( fd, "wb" );
+    if( out == NULL )
+    {
+        close( fd );
+        unlink( tmpPath );
+        free( tmpPath );
+        return;
+    }
+
+    memset( header, 0, sizeof(header) );
+    memcpy( h->magic, STORE_CACHE_MAGIC, sizeof(h->magic) );
+    h->version = STORE_CACHE_VERSION;
+    h->channels = (uint32_t)st->channels;
+    h->samplerate = (uint32_t)st->samplerate;
+    h->format = (uint32_t)st->format;
+    h->frames = (uint64_t)st->frames;
+    h->stride = stride;
+    h->source = source;
+
+    // the channel buffers are allocated out to a whole STORE_ALIGN
+    ok = fwrite( header, sizeof(header), 1, out ) == 1;
+    for( c = 0; ok && c < st->channels; c++ )
+        ok = stride == 0 || fwrite( st->data[c], stride, 1, out ) == 1;
+    ok = fclose( out ) == 0 && ok;
+
+    if( !ok || rename( tmpPath, cachePath ) != 0 )
+        unlink( tmpPath );
+    free( tmpPath );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_cached()
+// desc: map the cache if there is a good one, otherwise decode and write
+//       one for next time.  a cache in another format is replaced.  a file
+//       that decodes shorter than its header's frames is damaged or still
+//       being written, and isn't cached
+//-----------------------------------------------------------------------------
+static int store_cached( samplestore * st, const char * path, pcmFormat format,
+                         long long frames )
+{
+    uint64_t source;
+    char * cachePath;
+    int result;
+
+    memset( st, 0, sizeof(samplestore) );
+
+    cachePath = store_cache_path( path );
+    if( cachePath == NULL )
+        return store_decode( st, path, format );
+    source = store_hash( path );
+
+    if( source != 0 && store_map( st, cachePath, source, format ) == 0 )
+    {
+        free( cachePath );
+        return 0;
+    }
+
+    result = store_decode( st, path, format );
+    if( result == 0 && source != 0 && st->frames == frames )
+        store_write_cache( st, cachePath, source );
+    free( cachePath );
+
+    return result;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_format()
+// desc: the integer formats only ever hold a source exactly, anything
+//       else (float, 32-bit, lossy) stays float
+//-----------------------------------------------------------------------------
+pcmFormat store_format( int sfFormat, int mode )
+{
+    if( mode != STORE_COMPACT )
+        return PCM_FLOAT32;
+
+    switch( sfFormat & SF_FORMAT_SUBMASK )
+    {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8:
+    case SF_FORMAT_PCM_16:
+    case SF_FORMAT_ULAW:
+    case SF_FORMAT_ALAW:
+    case SF_FORMAT_DPCM_8:
+    case SF_FORMAT_DPCM_16:
+    case SF_FORMAT_ALAC_16:
+        return PCM_INT16;
+    case SF_FORMAT_PCM_24:
+    case SF_FORMAT_ALAC_20:
+    case SF_FORMAT_ALAC_24:
+        return PCM_INT24;
+    default:
+        return PCM_FLOAT32;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_load()
+// desc: only the header is read here, to pick the format
+//-----------------------------------------------------------------------------
+int store_load( samplestore * st, const char * path, int mode )
+{
+    SNDFILE * file;
+    SF_INFO info;
+
+    memset( st, 0, sizeof(samplestore) );
+    memset( &info, 0, sizeof(info) );
+
+    file = sf_open( path, SFM_READ, &info );
+    if( file == NULL )
+        return -1;
+    sf_close( file );
+
+    return store_cached( st, path, store_format( info.format, mode ), (long long)info.frames );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_split()
+// desc: one channel of an interleaved chunk into a planar buffer, at
+//       offset frames in.  the chunk holds floats for PCM_FLOAT32 and
+//       sf_readf_int() integers for the others
+//-----------------------------------------------------------------------------
+static void store_split( pcmFormat format, void * dst, long long offset, const void * chunk,
+                         int channel, int fileChannels, sf_count_t count )
+{
+    sf_count_t i;
+
+    if( format == PCM_FLOAT32 )
+    {
+        const float * src = (const float *)chunk + channel;
+        float * d = (float *)dst + offset;
+        for( i = 0; i < count; i++ )
+            d[i] = src[i * fileChannels];
+    }
+    else
+        pcm_pack( format, (char *)dst + offset * pcm_bytes( format ),
+                  (const int *)chunk + channel, fileChannels, (long)count );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_read_chunk()
+// desc: the next frames of the file, as store_split() wants them
+//-----------------------------------------------------------------------------
+static sf_count_t store_read_chunk( SNDFILE * file, pcmFormat format, void * chunk,
+                                    sf_count_t frames )
+{
+    if( format == PCM_FLOAT32 )
+        return sf_readf_float( file, (float *)chunk, frames );
+
+    return sf_readf_int( file, (int *)chunk, frames );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_decode()
+// desc: decode the whole file into planar channels
+//-----------------------------------------------------------------------------
+static int store_decode( samplestore * st, const char * path, pcmFormat format )
+{
+    int sampleBytes = pcm_bytes( format );
+    SNDFILE * infile;
+    SF_INFO info;
+    void * chunk;
+    long long frame = 0;
+    sf_count_t readcount;
+    int c;
+
+    memset( st, 0, sizeof(samplestore) );
+    memset( &info, 0, sizeof(info) );
+
+    infile = sf_open( path, SFM_READ, &info );
+    if( infile == NULL )
+        return -1;
+
+    st->channels = info.channels < STORE_MAX_CHANNELS ? info.channels : STORE_MAX_CHANNELS;
+    st->samplerate = info.samplerate;
+    st->frames = (long long)info.frames;
+    st->format = format;
+
+    // float or int, both 4 bytes a sample
+    chunk = malloc( STORE_CHUNK * info.channels * sizeof(float) );
+    for( c = 0; c < st->channels; c++ )
+        st->data[c] = store_alloc( st->frames, sampleBytes );
+    if( chunk == NULL || st->data[0] == NULL || st->data[st->channels - 1] == NULL )
+    {
+        free( chunk );
+        sf_close( infile );
+        store_free( st );
+        return -1;
+    }
+
+    // decode in chunks and split the channels apart
+    while( frame < st->frames &&
+           (readcount = store_read_chunk( infile, format, chunk, STORE_CHUNK )) > 0 )
+    {
+        if( frame + readcount > st->frames )
+            readcount = st->frames - frame;
+
+        for( c = 0; c < st->channels; c++ )
+            store_split( format, st->data[c], frame, chunk, c, info.channels, readcount );
+        frame += readcount;
+    }
+
+    // the header can overstate the length, keep what actually decoded
+    st->frames = frame;
+    for( c = 0; c < st->channels; c++ )
+        memset( (char *)st->data[c] + frame * sampleBytes, 0,
+                store_stride( frame, sampleBytes ) - frame * sampleBytes );
+
+    free( chunk );
+    sf_close( infile );
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_free()
+// desc: release the decoded audio
+//-----------------------------------------------------------------------------
+void store_free( samplestore * st )
+{
+    int c;
+
+    if( st->pager != NULL )
+    {
+        pager_free( st->pager );
+        st->pager = NULL;
+    }
+    else if( st->map != NULL )
+    {
+        munmap( st->map, st->mapBytes );
+        st->map = NULL;
+        st->mapBytes = 0;
+    }
+    else
+    {
+        for( c = 0; c < STORE_MAX_CHANNELS; c++ )
+            free( st->data[c] );
+    }
+    for( c = 0; c < STORE_MAX_CHANNELS; c++ )
+        st->data[c] = NULL;
+    st->frames = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_nap()
+// desc: ...
+//-----------------------------------------------------------------------------
+static void pager_nap( long ns )
+{
+    struct timespec ts;
+
+    ts.tv_sec = 0;
+    ts.tv_nsec = ns;
+    nanosleep( &ts, NULL );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_add()
+// desc: put a page on this pass's list once
+//-----------------------------------------------------------------------------
+static void pager_add( storePager * pg, long long page, int * count )
+{
+    if( *count < pg->maxPages && pg->stamp[page] != pg->pass )
+    {
+        pg->stamp[page] = pg->pass;
+        pg->order[(*count)++] = page;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_plan()
+// desc: the pages every reader wants, as many as fit in the budget.  the
+//       readers take turns a page at a time, read-ahead from each play
+//       position first and then the rest of each loop, so one long loop
+//       can't crowd out the start of the others.  returns how many
+//-----------------------------------------------------------------------------
+static int pager_plan( storePager * pg, long long readahead )
+{
+    long long start[STORE_MAX_WANTS], end[STORE_MAX_WANTS], position[STORE_MAX_WANTS];
+    long long at[STORE_MAX_WANTS], left[STORE_MAX_WANTS];
+    long long next;
+    int count = 0, r, more, pass;
+
+    for( r = 0; r < STORE_MAX_WANTS; r++ )
+    {
+        start[r] = atomic_load_explicit( &pg->want[r].start, memory_order_relaxed );
+        end[r] = start[r] + atomic_load_explicit( &pg->want[r].frames, memory_order_relaxed );
+        position[r] = atomic_load_explicit( &pg->want[r].position, memory_order_relaxed );
+        if( start[r] < 0 || end[r] > STORE_PAGE_FRAMES * pg->numPages )
+            end[r] = start[r];
+        if( position[r] < start[r] || position[r] >= end[r] )
+            position[r] = start[r];
+    }
+
+    for( pass = 0; pass < 2; pass++ )
+    {
+        for( r = 0; r < STORE_MAX_WANTS; r++ )
+        {
+            at[r] = position[r];
+            left[r] = end[r] - start[r];
+            if( pass == 0 && readahead < left[r] )
+                left[r] = readahead;
+        }
+
+        // one page per reader per round, following each loop round its end
+        for( more = 1; more && count < pg->maxPages; )
+        {
+            more = 0;
+            for( r = 0; r < STORE_MAX_WANTS; r++ )
+            {
+                if( left[r] <= 0 )
+                    continue;
+                more = 1;
+                pager_add( pg, at[r] / STORE_PAGE_FRAMES, &count );
+                next = (at[r] / STORE_PAGE_FRAMES + 1) * STORE_PAGE_FRAMES;
+                if( next >= end[r] )
+                {
+                    left[r] -= end[r] - at[r];
+                    at[r] = start[r];
+                }
+                else
+                {
+                    left[r] -= next - at[r];
+                    at[r] = next;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_buffer()
+// desc: a free page buffer, evicting the page wanted longest ago if there
+//       is none.  the page is taken out of the table first and the buffer
+//       only reused once no read could still be looking at it.  -1 if every
+//       page in memory is wanted this pass
+//-----------------------------------------------------------------------------
+static int pager_buffer( storePager * pg )
+{
+    long long oldest = pg->pass;
+    int b, victim = -1;
+
+    for( b = 0; b < pg->maxPages; b++ )
+    {
+        if( pg->holds[b] < 0 )
+            return b;
+        if( pg->stamp[pg->holds[b]] < oldest )
+        {
+            oldest = pg->stamp[pg->holds[b]];
+            victim = b;
+        }
+    }
+    if( victim < 0 )
+        return -1;
+
+    atomic_store( &pg->table[pg->holds[victim]], NULL );
+    while( atomic_load( &pg->readers ) != 0 )
+        pager_nap( STORE_READER_NAP );
+    pg->holds[victim] = -1;
+    atomic_fetch_sub_explicit( &pg->resident, 1, memory_order_relaxed );
+
+    return victim;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_load()
+// desc: decode one page into a buffer and publish it
+//-----------------------------------------------------------------------------
+static void pager_load( storePager * pg, int channels, pcmFormat format, long long page, int b )
+{
+    size_t channelBytes = (size_t)STORE_PAGE_FRAMES * pcm_bytes( format );
+    char * dst = pg->memory + (size_t)b * channels * channelBytes;
+    sf_count_t got = 0;
+    int c;
+
+    if( sf_seek( pg->file, page * STORE_PAGE_FRAMES, SEEK_SET ) >= 0 )
+        got = store_read_chunk( pg->file, format, pg->chunk, STORE_PAGE_FRAMES );
+    if( got < 0 )
+        got = 0;
+
+    for( c = 0; c < channels; c++ )
+    {
+        char * d = dst + c * channelBytes;
+        store_split( format, d, 0, pg->chunk, c, pg->fileChannels, got );
+        memset( d + got * pcm_bytes( format ), 0, channelBytes - got * pcm_bytes( format ) );
+    }
+
+    pg->holds[b] = page;
+    atomic_fetch_add_explicit( &pg->resident, 1, memory_order_relaxed );
+    atomic_store_explicit( &pg->table[page], dst, memory_order_release );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_main()
+// desc: pager thread.  it looks at the wants again every few pages so a
+//       moved loop gets its pages before the rest of an old one
+//-----------------------------------------------------------------------------
+static void * pager_main( void * arg )
+{
+    samplestore * st = (samplestore *)arg;
+    storePager * pg = st->pager;
+    long long readahead = (long long)STORE_READAHEAD * st->samplerate;
+    int count, i, b, loaded;
+
+    while( !atomic_load_explicit( &pg->quit, memory_order_acquire ) )
+    {
+        pg->pass = atomic_fetch_add( &pg->passes, 1 ) + 1;
+        count = pager_plan( pg, readahead );
+
+        loaded = 0;
+        for( i = 0; i < count && loaded < STORE_PAGES_PER_PASS; i++ )
+        {
+            if( atomic_load_explicit( &pg->table[pg->order[i]], memory_order_relaxed ) != NULL )
+                continue;
+            b = pager_buffer( pg );
+            if( b < 0 )
+                break;
+            pager_load( pg, st->channels, st->format, pg->order[i], b );
+            loaded++;
+        }
+
+        if( loaded == 0 )
+        {
+            atomic_store( &pg->idlePass, pg->pass );
+            pager_nap( atomic_load_explicit( &pg->syncing, memory_order_relaxed ) ?
+                       STORE_READER_NAP : STORE_PAGER_NAP );
+        }
+    }
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pager_free()
+// desc: stop the pager thread and release the pages
+//-----------------------------------------------------------------------------
+static void pager_free( storePager * pg )
+{
+    if( pg->thread != 0 )
+    {
+        atomic_store( &pg->quit, true );
+        pthread_join( pg->thread, NULL );
+    }
+    if( pg->file != NULL )
+        sf_close( pg->file );
+    free( pg->chunk );
+    free( (void *)pg->table );
+    free( pg->stamp );
+    free( pg->order );
+    free( pg->memory );
+    free( pg->holds );
+    free( pg );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_open()
+// desc: the pager gets its own libsndfile handle and keeps it to itself
+//-----------------------------------------------------------------------------
+int store_open( samplestore * st, const char * path, size_t budget, int mode )
+{
+    pcmFormat format;
+    storePager * pg;
+    SNDFILE * file;
+    SF_INFO info;
+    size_t pageBytes;
+    long long p;
+    int b, r;
+
+    memset( st, 0, sizeof(samplestore) );
+    memset( &info, 0, sizeof(info) );
+
+    file = sf_open( path, SFM_READ, &info );
+    if( file == NULL )
+        return -1;
+
+    st->channels = info.channels < STORE_MAX_CHANNELS ? info.channels : STORE_MAX_CHANNELS;
+    format = store_format( info.format, mode );
+    pageBytes = (size_t)st->channels * STORE_PAGE_FRAMES * pcm_bytes( format );
+    if( (uint64_t)info.frames * st->channels * pcm_bytes( format ) <= budget ||
+        !info.seekable || budget < 2 * pageBytes )
+    {
+        sf_close( file );
+        return store_cached( st, path, format, (long long)info.frames );
+    }
+
+    pg = (storePager *)calloc( 1, sizeof(storePager) );
+    if( pg == NULL )
+    {
+        sf_close( file );
+        return -1;
+    }
+    st->pager = pg;
+    st->samplerate = info.samplerate;
+    st->frames = (long long)info.frames;
+    st->format = format;
+
+    pg->file = file;
+    pg->fileChannels = info.channels;
+    pg->numPages = (st->frames + STORE_PAGE_FRAMES - 1) / STORE_PAGE_FRAMES;
+    pg->maxPages = (int)(budget / pageBytes < (size_t)pg->numPages ? budget / pageBytes : (size_t)pg->numPages);
+    pg->chunk = malloc( (size_t)STORE_PAGE_FRAMES * info.channels * sizeof(float) );
+    pg->table = (_Atomic(char *) *)calloc( pg->numPages, sizeof(*pg->table) );
+    pg->stamp = (long long *)calloc( pg->numPages, sizeof(long long) );
+    pg->order = (long long *)calloc( pg->maxPages, sizeof(long long) );
+    pg->memory = (char *)malloc( (size_t)pg->maxPages * pageBytes );
+    pg->holds = (long long *)malloc( pg->maxPages * sizeof(long long) );
+    if( pg->chunk == NULL || pg->table == NULL || pg->stamp == NULL ||
+        pg->order == NULL || pg->memory == NULL || pg->holds == NULL )
+    {
+        store_free( st );
+        return -1;
+    }
+
+    for( p = 0; p < pg->numPages; p++ )
+    {
+        atomic_init( &pg->table[p], NULL );
+        pg->stamp[p] = 0;
+    }
+    for( b = 0; b < pg->maxPages; b++ )
+        pg->holds[b] = -1;
+    for( r = 0; r < STORE_MAX_WANTS; r++ )
+    {
+        atomic_init( &pg->want[r].start, 0 );
+        atomic_init( &pg->want[r].frames, 0 );
+        atomic_init( &pg->want[r].position, 0 );
+    }
+    atomic_init( &pg->readers, 0 );
+    atomic_init( &pg->resident, 0 );
+    atomic_init( &pg->misses, 0 );
+    atomic_init( &pg->passes, 0 );
+    atomic_init( &pg->idlePass, 0 );
+    atomic_init( &pg->syncing, 0 );
+    atomic_init( &pg->quit, false );
+
+    if( pthread_create( &pg->thread, NULL, pager_main, st ) != 0 )
+    {
+        pg->thread = 0;
+        store_free( st );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_want()
+// desc: ...
+//-----------------------------------------------------------------------------
+void store_want( samplestore * st, int reader, long long start, long long frames,
+                 long long position )
+{
+    storeWant * w;
+
+    if( st->pager == NULL || reader < 0 || reader >= STORE_MAX_WANTS )
+        return;
+
+    w = &st->pager->want[reader];
+    atomic_store_explicit( &w->start, start, memory_order_relaxed );
+    atomic_store_explicit( &w->frames, frames, memory_order_relaxed );
+    atomic_store_explicit( &w->position, position, memory_order_relaxed );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_sync()
+// desc: a pass that started after this call and found nothing to load
+//-----------------------------------------------------------------------------
+void store_sync( samplestore * st )
+{
+    long long target;
+
+    if( st->pager == NULL )
+        return;
+
+    // read-modify-write so the pass that follows sees the wants made
+    // before this call
+    atomic_fetch_add( &st->pager->syncing, 1 );
+    target = atomic_fetch_add( &st->pager->passes, 0 ) + 1;
+    while( atomic_load( &st->pager->idlePass ) < target )
+        pager_nap( STORE_READER_NAP );
+    atomic_fetch_sub( &st->pager->syncing, 1 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_resident()
+// desc: ...
+//-----------------------------------------------------------------------------
+size_t store_resident( const samplestore * st )
+{
+    if( st->pager != NULL )
+        return (size_t)atomic_load_explicit( &st->pager->resident, memory_order_relaxed )
+             * st->channels * STORE_PAGE_FRAMES * pcm_bytes( st->format );
+
+    return (size_t)store_stride( st->frames, pcm_bytes( st->format ) ) * st->channels;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_misses()
+// desc: ...
+//-----------------------------------------------------------------------------
+uint64_t store_misses( const samplestore * st )
+{
+    return st->pager != NULL ?
+        atomic_load_explicit( &st->pager->misses, memory_order_relaxed ) : 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_read_paged()
+// desc: a read registers itself so the pager can tell when a page it took
+//       out of the table is no longer being copied from
+//-----------------------------------------------------------------------------
+static void store_read_paged( const samplestore * st, long long frame, float * out, long frames )
+{
+    storePager * pg = st->pager;
+    int sampleBytes = pcm_bytes( st->format );
+    const char * page;
+    long long offset;
+    long n;
+
+    atomic_fetch_add( &pg->readers, 1 );
+
+    while( frames > 0 )
+    {
+        offset = frame % STORE_PAGE_FRAMES;
+        n = STORE_PAGE_FRAMES - offset < frames ? (long)(STORE_PAGE_FRAMES - offset) : frames;
+        page = atomic_load( &pg->table[frame / STORE_PAGE_FRAMES] );
+
+        if( page != NULL )
+            pcm_stereo( st->format, out, page + offset * sampleBytes,
+                        page + ((st->channels - 1) * STORE_PAGE_FRAMES + offset) * sampleBytes, n );
+        else
+        {
+            memset( out, 0, 2 * n * sizeof(float) );
+            atomic_fetch_add_explicit( &pg->misses, n, memory_order_relaxed );
+        }
+
+        out += 2 * n;
+        frame += n;
+        frames -= n;
+    }
+
+    atomic_fetch_sub( &pg->readers, 1 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: store_read_stereo()
+// desc: interleave frames into a stereo buffer, converting to float
+//-----------------------------------------------------------------------------
+void store_read_stereo( const samplestore * st, long long frame, float * out, long frames )
+{
+    int sampleBytes = pcm_bytes( st->format );
+
+    if( st->pager != NULL )
+    {
+        store_read_paged( st, frame, out, frames );
+        return;
+    }
+
+    pcm_stereo( st->format, out, (const char *)st->data[0] + frame * sampleBytes,
+                (const char *)st->data[st->channels - 1] + frame * sampleBytes, frames );
+}
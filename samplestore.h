@@ -0,0 +1,101 @@
+//-----------------------------------------------------------------------------
+// name: samplestore.h
+// desc: decoded, in-memory copy of a sound file shared by all slices
+//
+//   the file is decoded once through libsndfile into planar float channels,
+//   each one 64-byte aligned.  slices address it by frame offset, so a seek
+//   is just pointer arithmetic and no decoder is touched after loading.
+//
+//   the decoded channels are also written to a cache directory, by default
+//   $XDG_CACHE_HOME/slicesampler, as <file>-<hash of its path>.decoded: a
+//   page of header (sample rate, channels, frames, format and a hash of
+//   the source) followed by the planar samples.
+//   later loads of an unchanged file map that straight in instead of
+//   decoding, every process on the same file shares the pages, and the
+//   load reads them all in before it returns so no read waits for disk.
+//
+//   with STORE_COMPACT a 16 or 24-bit source is kept as packed integers of
+//   its own depth instead of float, half or three quarters the memory for
+//   the same audio, and turned back into float as it is read.
+//
+//   a file too big for the memory budget is streamed instead: it is cut
+//   into pages of STORE_PAGE_FRAMES, and a pager thread keeps in memory
+//   only the pages readers have asked for with store_want(), read-ahead
+//   from each play position first and then the rest of each loop, never
+//   more than the budget.  a read never waits for the disk, a page that
+//   isn't in yet reads as silence.
+//-----------------------------------------------------------------------------
+#ifndef __SAMPLESTORE_H__
+#define __SAMPLESTORE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pcm.h"
+
+
+#define STORE_MAX_CHANNELS      2
+#define STORE_ALIGN             64
+#define STORE_CACHE_SUFFIX      ".decoded"
+#define STORE_PAGE_FRAMES       32768//frames per page when streaming
+#define STORE_READAHEAD         5//seconds past each play position loaded first
+#define STORE_MAX_WANTS         64//readers that can ask for pages
+#define STORE_DEFAULT_BUDGET    ((size_t)512 << 20)
+
+// how samples are kept in memory
+#define STORE_FLOAT             0//float, whatever the source
+#define STORE_COMPACT           1//integer sources packed at their own depth
+
+typedef struct storePager storePager;
+
+typedef struct {
+    void *data[STORE_MAX_CHANNELS];     // planar channels, STORE_ALIGN aligned
+    pcmFormat format;                   // what data holds
+    int channels;                       // channels kept from the file (1 or 2)
+    int samplerate;
+    long long frames;
+    void *map;                          // cache file mapping, NULL if decoded
+    size_t mapBytes;
+    storePager *pager;                  // streaming, NULL if the file is all in
+} samplestore;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// map the decoded cache of a file, or decode it and write the cache; mode
+// is STORE_FLOAT or STORE_COMPACT.  returns 0 on success
+int store_load( samplestore * st, const char * path, int mode );
+// store_load() if the decoded file fits in budget bytes, otherwise stream
+// it in pages using no more than budget bytes; returns 0 on success
+int store_open( samplestore * st, const char * path, size_t budget, int mode );
+void store_free( samplestore * st );
+
+// copy frames starting at frame into an interleaved stereo buffer,
+// mono files are duplicated into both channels.  any number of threads
+void store_read_stereo( const samplestore * st, long long frame, float * out, long frames );
+
+// streaming: reader (0 .. STORE_MAX_WANTS-1) will play frames from start
+// on a loop, currently at position; frames 0 drops the reader.  no-op when
+// the whole file is in memory, never blocks
+void store_want( samplestore * st, int reader, long long start, long long frames,
+                 long long position );
+// streaming: wait until everything wanted is in or the budget is full.
+// for offline rendering, never call it from the audio thread
+void store_sync( samplestore * st );
+// directory decoded caches are written to and read from: NULL for the
+// default, "" for no caching.  call before the first load
+void store_cache_dir( const char * dir );
+// the format a file whose libsndfile format is sfFormat is kept in
+pcmFormat store_format( int sfFormat, int mode );
+// bytes of decoded audio in memory
+size_t store_resident( const samplestore * st );
+// frames that read as silence because their page wasn't in yet
+uint64_t store_misses( const samplestore * st );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
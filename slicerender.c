@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// name: slicerender.c
+// desc: headless front end for the slice sampler engine
+//
+//   bounces every slice of a file to a wav without a window or an audio
+//   device, so it builds and runs on machines with no OpenGL or PortAudio.
+//
+//   usage: slicerender <audio input filename> [number of slices]
+//                      <output filename> [--seconds N] [--stats]
+//                      [--budget MB] [--compact] [--stft]
+//                      [--cache DIR | --no-cache] [--add <audio file>]...
+//
+//   --budget caps the decoded audio kept in memory, longer files are
+//   streamed from disk.  --compact keeps 16 and 24-bit files at their own
+//   depth instead of as float, so more of them fit in the budget.  each
+//   --add puts another file in the pool and the slices are dealt out
+//   across all of them in turn.
+//
+//   --stft filters with an fft mask instead of biquads.
+//
+//   --cache keeps decoded files in DIR instead of
+//   $XDG_CACHE_HOME/slicesampler, --no-cache decodes every time and
+//   writes nothing.
+//
+//   --stats prints how long each block took to render as a fraction of
+//   the time it plays for, the same figures the GUI reports for its
+//   audio callback.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "stats.h"
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: main()
+// desc: ...
+//-----------------------------------------------------------------------------
+int main( int argc, char * argv[] )
+{
+    const char * positional[3];
+    const char * audioFilename;
+    const char * renderFilename;
+    const char * slicesArg = NULL;
+    int numPositional = 0;
+    int numSlices = DEFAULT_SLICES;
+    int numFiles;
+    int printStats = 0;
+    int compact = 0;
+    int stft = 0;
+    const char * cacheDir = NULL;
+    callbackStats stats;
+    double seconds = DEFAULT_RENDER_SECONDS;
+    double budget = 0;
+    int i, result;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[i], "--seconds" ) == 0 && i + 1 < argc )
+            seconds = atof( argv[++i] );
+        else if( strcmp( argv[i], "--stats" ) == 0 )
+            printStats = 1;
+        else if( strcmp( argv[i], "--budget" ) == 0 && i + 1 < argc )
+            budget = atof( argv[++i] );
+        else if( strcmp( argv[i], "--compact" ) == 0 )
+            compact = 1;
+        else if( strcmp( argv[i], "--stft" ) == 0 )
+            stft = 1;
+        else if( strcmp( argv[i], "--cache" ) == 0 && i + 1 < argc )
+            cacheDir = argv[++i];
+        else if( strcmp( argv[i], "--no-cache" ) == 0 )
+            cacheDir = "";
+        else if( strcmp( argv[i], "--add" ) == 0 && i + 1 < argc )
+            i++;
+        else if( numPositional < 3 )
+            positional[numPositional++] = argv[i];
+        else
+        {
+            numPositional = 0;
+            break;
+        }
+    }
+
+    if( numPositional < 2 )
+    {
+        printf( "usage: slicerender <audio input filename> [number of slices]\n" );
+        printf( "                   <output filename> [--seconds N] [--stats]\n" );
+        printf( "                   [--budget MB] [--compact] [--stft]\n" );
+        printf( "                   [--cache DIR | --no-cache] [--add <audio file>]...\n" );
+        return 1;
+    }
+    audioFilename = positional[0];
+    renderFilename = positional[numPositional - 1];
+    if( numPositional == 3 )
+        slicesArg = positional[1];
+
+    if( slicesArg != NULL )
+    {
+        numSlices = atoi( slicesArg );
+        if( numSlices < 1 || numSlices > MAX_SLICES )
+        {
+            printf( "Error: number of slices must be between 1 and %d\n", MAX_SLICES );
+            return 1;
+        }
+    }
+    if( seconds <= 0 )
+    {
+        printf( "Error: --seconds must be positive\n" );
+        return 1;
+    }
+    if( budget < 0 )
+    {
+        printf( "Error: --budget must be positive\n" );
+        return 1;
+    }
+
+    engine_memory_budget( (size_t)(budget * 1048576) );
+    engine_compact_samples( compact );
+    engine_stft_filter( stft );
+    engine_cache_dir( cacheDir );
+    if( engine_init( audioFilename, numSlices ) != 0 )
+        return 1;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[i], "--add" ) == 0 && i + 1 < argc &&
+            engine_add_file( argv[++i] ) < 0 )
+        {
+            engine_free();
+            return 1;
+        }
+    }
+    numFiles = engine_file_count();
+    for( i = 0; i < numSlices; i++ )
+        engine_send( CMD_FILE, i, i % numFiles );
+
+    stats_init( &stats, (double)BUFFER_SIZE / SAMPLING_RATE );
+    result = engine_render_file( renderFilename, seconds, &stats );
+    if( printStats )
+        stats_print( &stats, stdout );
+    engine_free();
+
+    return result;
+}
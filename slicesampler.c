@@ -14,9 +14,10 @@
 #include <portaudio.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <SOIL/SOIL.h>
-#include <sndfile.h>//libsndfile library
-#include "fft.h"
+#include "engine.h"
+#include "stats.h"
 
 // OpenGL
 //#ifdef __MACOSX_CORE__
@@ -42,29 +43,17 @@
 // global variables and #defines
 //-----------------------------------------------------------------------------
 #define FORMAT                  paFloat32
-#define BUFFER_SIZE             2048
 #define SAMPLE                  float
-#define SAMPLING_RATE           44100
 #define MONO                    1
-#define STEREO                  2
 #define cmp_abs(x)              ( sqrt( (x).re * (x).re + (x).im * (x).im ) )
 #define INIT_WIDTH              800
 #define INIT_HEIGHT             600
 #define INIT_FREQUENCY          440
 #define INC_FREQUENCY           5
-#define INIT_START              0
-#define INIT_VOLUME             0.8
 #define INC_VAL_MOUSE           1.0f
 #define INC_VAL_KB              .75f
-#define DEFAULT_LOOP_LENGTH     100000
-#define INC_LOOP_LENGTH         25000
 #define START_NUDGE_AMOUNT      10000
 #define FAST_NUDGE              100000
-#define LOWPASS_INCR            5
-#define HIGHPASS_INCR           2
-#define WINDOW_SIZE             (BUFFER_SIZE/4)
-#define HOP_SIZE                (WINDOW_SIZE/2)
-#define VOLUME_INCR             0.1
 
 typedef double  MY_TYPE;
 typedef char BYTE;   // 8-bit unsigned entity.
@@ -74,56 +63,6 @@ typedef struct {
     int y;
 } Pos;
 
-//individual slice data
-typedef struct {
-    SNDFILE *infile;
-    SF_INFO sfinfoInput;
-    bool playing;
-    int start;
-    int loopCounter;
-    int loopLength;
-    float volume;
-    float muter;
-    float lowpass;
-    float highpass;
-    float buffer[BUFFER_SIZE * STEREO];
-    float filterLeft[BUFFER_SIZE];
-    float filterRight[BUFFER_SIZE];
-    float prev_left[WINDOW_SIZE];
-    float prev_right[WINDOW_SIZE];
-
-} slice;
-
-typedef struct {
-    float overlap; // Percentage of overlap
-    int overlap_samples; // Overlap in samples
-    int osamp; // Oversampling factor (WINDOW_SIZE / HOP_SIZE)
-    bool change;
-    slice sliceA;
-    slice sliceB;
-    slice sliceC;
-    slice sliceD;
-    int sliceSelector;
-    //members for filtering
-    float file_buff[STEREO * (BUFFER_SIZE + HOP_SIZE)];
-    float window[WINDOW_SIZE];
-    float curr_win[WINDOW_SIZE];
-    int lowpass;
-    int highpass;
-
-} sndFile;
-
-//Filter GLobals
-float curr_magnitude[WINDOW_SIZE/2];
-float curr_phase[WINDOW_SIZE/2];
-
-float prev_magnitude[WINDOW_SIZE/2];
-float prev_phase[WINDOW_SIZE/2];
-
-
-
-
-
 //struct for GUI objects 
 typedef struct {
     GLuint texture_id;
@@ -143,15 +82,19 @@ GLint g_buffer_size = BUFFER_SIZE;
 unsigned int g_channels = STEREO;
 SAMPLE g_buffer[BUFFER_SIZE];
 SAMPLE g_window[BUFFER_SIZE];
-float *songBuffer;
 
 
-//Initialize sound file struct and slices
-sndFile data;
+//Slice the edit keys apply to
+int g_sliceSelector = 0;
 
 
 // Threads Management
-GLboolean g_ready = false;
+atomic_bool g_ready = false;
+
+// callback timing, written by the audio thread only
+callbackStats g_stats;
+bool g_printStats = false;
+bool g_renderAhead = false;
 
 // fill mode
 GLenum g_fillmode = GL_FILL;
@@ -206,7 +149,7 @@ float computeRMS(SAMPLE *buffer);
 void drawFace();
 void drawTimeDomain(SAMPLE *buffer, int side);
 void drawCube(int x, int y, int side, SAMPLE *buffer);
-void drawWindowedTimeDomain(SAMPLE * buffer);
+void drawWindowedTimeDomain(const SAMPLE * buffer);
 void reshapeFunc( int width, int height );
 void keyboardFunc( unsigned char, int, int );
 void specialKey( int key, int x, int y );
@@ -214,24 +157,15 @@ void specialUpKey( int key, int x, int y);
 void initialize_graphics( );
 void initialize_glut(int argc, char *argv[]);
 void initialize_gui();
-void initialize_audio(char * audioFilename);
+void initialize_audio();
 void stop_portAudio();
-void startstop();
-void setLocation(int location);
-void increaseLoopLength();
-void decreaseLoopLength();
-void nudgeLocation(int nudgeAmount);
-void incrementLoops();
-void resetLoops();
-void muteSlice();
+void print_stats();
+void selectSlice(int s);
+void sendCommand(commandType type, int amount);
+void stepFile(int step);
+void reloadFile();
+int addFiles(int argc, char *argv[]);
 void drawPad();
-void filter(SAMPLE *buffer, SAMPLE *prev_win, int selector);
-void volumeIncrease();
-void volumeDecrease();
-void decreaseLowpass();
-void increaseLowpass();
-void decreaseHighpass();
-void increaseHighpass();
 
 //Mouse callback functions
 void mouseFunc(int button, int state, int x, int y);
@@ -261,6 +195,11 @@ void help()
     printf( "'b' - select slice B\n");
     printf( "'c' - select slice C\n");
     printf( "'d' - select slice D\n");
+    printf( "',' - select previous slice\n");
+    printf( "'.' - select next slice\n");
+    printf( "'<' - play the previous file on the slice\n");
+    printf( "'>' - play the next file on the slice\n");
+    printf( "'l' - reload the slice's file from disk\n");
     printf( "----------------------------------------------------\n" );
     printf( "'[' - decrease loop length\n" );
     printf( "']' - increase loop length\n" );
@@ -273,13 +212,45 @@ void help()
     printf( "'t' increases volume of a slice\n" \
             "'y' decreases volume of a slice \n");
     printf( "'f' - toggle fullscreen\n" );
+    printf( "'p' - print callback timing, xruns and file memory\n" );
     printf( "'m' - mute on/off\n"); 
     printf( "'q' - quit\n" );
     printf( "----------------------------------------------------\n" );
+    printf( "--render <out.wav> [--seconds N] - bounce all slices\n" \
+            "    to a file without opening a window or audio device\n");
+    printf( "--stats - print callback timing and xruns on exit\n");
+    printf( "--ahead - render a block ahead: one more block of latency,\n" \
+            "    a whole buffer period to render each block in\n");
+    printf( "--budget MB - decoded audio kept in memory, longer files\n" \
+            "    are streamed from disk\n");
+    printf( "--compact - keep 16 and 24-bit files at their own depth\n" \
+            "    instead of as float, more audio fits in the budget\n");
+    printf( "--stft - filter with an fft mask instead of biquads: steeper\n" \
+            "    cutoffs, a quarter block more latency\n");
+    printf( "--cache DIR - where decoded files are kept for the next load,\n" \
+            "    $XDG_CACHE_HOME/slicesampler by default\n");
+    printf( "--no-cache - decode every load and write no cache\n");
+    printf( "--add <file> - another file for the slices, may be repeated\n");
+    printf( "----------------------------------------------------\n" );
     printf( "\n" );
 }
 
 
+//-----------------------------------------------------------------------------
+// Name: print_stats( )
+// Desc: callback timing, plus the blocks render-ahead was late with and
+//       what each file takes in memory
+//-----------------------------------------------------------------------------
+void print_stats()
+{
+    stats_print(&g_stats, stdout);
+    if (g_renderAhead) {
+        printf("render-ahead blocks missed: %llu\n", engine_missed_blocks());
+    }
+    engine_print_files();
+}
+
+
 //-----------------------------------------------------------------------------
 // Name: paCallback( )
 // Desc: callback from portAudio
@@ -291,188 +262,25 @@ static int paCallback(const void *inputBuffer,
 {
     //initialize output audio buffer
     SAMPLE * out = (SAMPLE *)outputBuffer;    
+    unsigned long long start = stats_now();
+    int xruns = 0;
 
-    int i, j; 
-    int readcountA, readcountB, readcountC, readcountD;
-
-    /* read data from file*/
-    readcountA = sf_readf_float (data.sliceA.infile, data.sliceA.buffer, framesPerBuffer); 
-    readcountB = sf_readf_float (data.sliceB.infile, data.sliceB.buffer, framesPerBuffer + data.overlap_samples);
-    readcountC = sf_readf_float (data.sliceC.infile, data.sliceC.buffer, framesPerBuffer); 
-    readcountD = sf_readf_float (data.sliceD.infile, data.sliceD.buffer, framesPerBuffer);  
-    
-    //Slice A, B, C, D, Off on
-    if (!data.sliceA.playing) {
-        sf_seek(data.sliceA.infile, data.sliceA.start, SEEK_SET);
-
-        readcountA = sf_readf_float (data.sliceA.infile, data.sliceA.buffer+(readcountA*STEREO), framesPerBuffer-readcountA);
-
-        data.sliceA.muter = 0.0;  
-    }
-    //output audio
-    else {
-        data.sliceA.muter = 1.0;
-    }
-    if (!data.sliceB.playing) {
-        sf_seek(data.sliceB.infile, data.sliceB.start, SEEK_SET);
-
-        readcountB = sf_readf_float (data.sliceB.infile, data.sliceB.buffer+(readcountB*STEREO), framesPerBuffer-readcountB + data.overlap_samples);
-
-        data.sliceB.muter = 0.0;  
-    }
-
-    //output audio
-    else {
-        data.sliceB.muter = 1.0;
-    }
-    if (!data.sliceC.playing) {
-        sf_seek(data.sliceC.infile, data.sliceC.start, SEEK_SET);
-
-        readcountC = sf_readf_float (data.sliceC.infile, data.sliceC.buffer+(readcountC*STEREO), framesPerBuffer-readcountC);
-
-        data.sliceC.muter = 0.0;  
-    }
-
-    //output audio
-    else {
-        data.sliceC.muter = 1.0;
-    }
-    if (!data.sliceD.playing) {
-        sf_seek(data.sliceD.infile, data.sliceD.start, SEEK_SET);
-
-        readcountD = sf_readf_float (data.sliceD.infile, data.sliceD.buffer+(readcountD*STEREO), framesPerBuffer-readcountD);
-
-        data.sliceD.muter = 0.0;  
-    }
-
-    //output audio
-    else {
-        data.sliceD.muter = 1.0;
-    }
-
-    //Rewind overlap
-    sf_seek( data.sliceB.infile, -data.overlap_samples, SEEK_CUR );
-    
-    resetLoops();
-
-    //de-interleave
-
-    // for (i = 0; i < framesPerBuffer+data.overlap_samples; i++){
-    //     data.sliceB.filterLeft[i] = data.sliceB.buffer[2 * i];
-    //     data.sliceB.filterRight[i] = data.sliceB.buffer[2 * i +1];
-    // }    
-    // //filter left
-    // filter(data.sliceB.filterLeft, data.sliceB.prev_left, 1);
-    // //filter right
-    // filter(data.sliceB.filterRight,data.sliceB.prev_right, 1);
-
-    // //interleave
-    // for (i = 0; i < framesPerBuffer; i++){
-    //     data.sliceB.buffer[2 * i] = data.sliceB.filterLeft[i]; 
-    //     data.sliceB.buffer[2 * i + 1] = data.sliceB.filterRight[i];
-    // }
-
-    /* combine samples adjusted for volume from each file for each channel */
-    for (i = 0; i < framesPerBuffer * STEREO; i+=2) {
-        out[i] = ((data.sliceA.volume * data.sliceA.buffer[i] * data.sliceA.muter) + (data.sliceB.volume * data.sliceB.buffer[i] * data.sliceB.muter) + (data.sliceC.volume * data.sliceC.buffer[i] * data.sliceC.muter) + (data.sliceD.volume * data.sliceD.buffer[i] * data.sliceD.muter));
-        out[i+1] = ((data.sliceA.volume * data.sliceA.buffer[i+1] * data.sliceA.muter) + (data.sliceB.volume * data.sliceB.buffer[i+1] * data.sliceB.muter) + (data.sliceC.volume * data.sliceC.buffer[i+1] * data.sliceC.muter) + (data.sliceD.volume * data.sliceD.buffer[i+1] * data.sliceD.muter));
-        incrementLoops();
-    }
+    engine_render(out, framesPerBuffer);
 
+    /* let the GUI see where we are */
+    engine_publish();
 
     //set flag
-    g_ready = true;
+    atomic_store(&g_ready, true);
+
+    //timing covers everything we do in here
+    if (statusFlags & paOutputUnderflow) xruns |= STATS_UNDERFLOW;
+    if (statusFlags & paOutputOverflow) xruns |= STATS_OVERFLOW;
+    stats_record(&g_stats, start, xruns,
+            timeInfo->outputBufferDacTime - timeInfo->currentTime);
 
     return paContinue;
     return 0;
-}
- //-----------------------------------------------------------------------------
-// Name: filter
-// Desc: Applies low pass and high pass filters 
-//-----------------------------------------------------------------------------
- void filter(SAMPLE *buffer, SAMPLE *prev_win, int selector) {
- /* FILTERSSS */
-    /* STFT */
-    int i, j;
-    float hipass, lowpass;
-    for (i = 0; i < BUFFER_SIZE; i+=HOP_SIZE)
-    {
-        /* Apply window to current frame */
-        for (j = 0; j < WINDOW_SIZE; j++) {
-            data.curr_win[j] = buffer[i+j];
-        }
-        apply_window(data.curr_win, data.window, WINDOW_SIZE);
-
-        /* FFT */
-        rfft(data.curr_win, WINDOW_SIZE/2, FFT_FORWARD );
-        complex * curr_cbuf = (complex *)data.curr_win;
-        rfft( prev_win, WINDOW_SIZE/2, FFT_FORWARD );
-        complex * prev_cbuf = (complex *)prev_win;
-
-        /* Get Magnitude and Phase (polar coordinates) */
-        for (j = 0; j < WINDOW_SIZE/2; ++j)
-        {
-            curr_magnitude[j] = cmp_abs(curr_cbuf[j]);
-            curr_phase[j] = atan2f(curr_cbuf[j].im, curr_cbuf[j].re);
-
-            prev_magnitude[j] = cmp_abs(prev_cbuf[j]);
-            prev_phase[j] = atan2f(prev_cbuf[j].im, prev_cbuf[j].re);
-        }
-         switch (selector){
-            case 0:
-                lowpass = data.sliceA.lowpass;
-                hipass = WINDOW_SIZE/4 - data.sliceA.highpass;
-                
-                break;
-    
-            case 1:
-                lowpass = data.sliceB.lowpass;
-                hipass = WINDOW_SIZE/4 - data.sliceB.highpass;
-                break;
-
-            case 2:
-                lowpass = data.sliceC.lowpass;
-                hipass = WINDOW_SIZE/4 - data.sliceC.highpass;
-                break;
-        
-            case 3:
-                lowpass = data.sliceD.lowpass;
-                hipass = WINDOW_SIZE/4 - data.sliceD.highpass;
-                break;   
-        }
-         /* Filter windows */
-          for (j = 0; j < WINDOW_SIZE/2; ++j) {
-
-              if ((j > WINDOW_SIZE/4 - lowpass && j < WINDOW_SIZE/4 + lowpass) || 
-                  j < WINDOW_SIZE/4 - hipass || j > WINDOW_SIZE/4 + hipass)
-              {
-                  curr_magnitude[j] = 0;
-                  prev_magnitude[j] = 0;
-              }
-          }
-
-        /* Back to Cartesian coordinates */
-        for (j = 0; j < WINDOW_SIZE/2; j++) {
-            curr_cbuf[j].re = curr_magnitude[j] * cosf(curr_phase[j]);
-            curr_cbuf[j].im = curr_magnitude[j] * sinf(curr_phase[j]);
-            prev_cbuf[j].re = prev_magnitude[j] * cosf(prev_phase[j]);
-            prev_cbuf[j].im = prev_magnitude[j] * sinf(prev_phase[j]);
-        }
-
-        // /* Back to Time Domain */
-        rfft( (float*)curr_cbuf, WINDOW_SIZE/2, FFT_INVERSE );
-        rfft( (float*)prev_cbuf, WINDOW_SIZE/2, FFT_INVERSE );
-
-        /* Assign to the output */
-        for (j = 0; j < HOP_SIZE; j++) {
-            buffer[i+j] = prev_win[j+HOP_SIZE] + data.curr_win[j];
-        }
-
-        /* Update previous window */
-        for (j = 0; j < WINDOW_SIZE; j++) {
-            prev_win[j] = data.curr_win[j];
-        }
-    }
 }
 //-----------------------------------------------------------------------------
 // Name: initialize_gui( )
@@ -556,119 +364,18 @@ void initialize_glut(int argc, char *argv[]) {
 
 
 //-----------------------------------------------------------------------------
-// Name: initialize_audio( RtAudio *dac )
+// Name: initialize_audio( )
 // Desc: Initializes PortAudio with the global vars and the stream
 //-----------------------------------------------------------------------------
-void initialize_audio(char * audioFilename) {
-
-    //Clear structs
-    memset(&data.sliceA.sfinfoInput, 0, sizeof(data.sliceA.sfinfoInput));
-    memset(&data.sliceB.sfinfoInput, 0, sizeof(data.sliceB.sfinfoInput));
-    memset(&data.sliceC.sfinfoInput, 0, sizeof(data.sliceC.sfinfoInput));
-    memset(&data.sliceD.sfinfoInput, 0, sizeof(data.sliceD.sfinfoInput));
-
-    //Open Input Audio File
-    data.sliceA.infile = sf_open(audioFilename, SFM_READ, &data.sliceA.sfinfoInput);
-    if (data.sliceA.infile == NULL) {
-        printf ("Error: could not open file: %s\n", audioFilename) ;
-        puts(sf_strerror (NULL)) ;
-        exit(1);
-    }
-
-    printf("Audio file: Frames: %d Channels: %d Samplerate: %d\n\n", 
-            (int)data.sliceA.sfinfoInput.frames, data.sliceA.sfinfoInput.channels, data.sliceA.sfinfoInput.samplerate);
-
-    //check if audio file is between 10 seconds and 5 minutes
-    if (data.sliceA.sfinfoInput.frames / SAMPLING_RATE >= 300 || data.sliceA.sfinfoInput.frames / SAMPLING_RATE < 10){
-        printf("Error: Audio file must be between 10 seconds and 5 minutes in length.\n");
-        exit(1);
-    }
-
-    //Open Input Audio File
-    data.sliceB.infile = sf_open(audioFilename, SFM_READ, &data.sliceB.sfinfoInput);
-    if (data.sliceB.infile == NULL) {
-        printf ("Error: could not open file: %s\n", audioFilename) ;
-        puts(sf_strerror (NULL)) ;
-        exit(1);
-    }
-    //Open Input Audio File
-    data.sliceC.infile = sf_open(audioFilename, SFM_READ, &data.sliceC.sfinfoInput);
-    if (data.sliceC.infile == NULL) {
-        printf ("Error: could not open file: %s\n", audioFilename) ;
-        puts(sf_strerror (NULL)) ;
-        exit(1);
-    }
-    //Open Input Audio File
-    data.sliceD.infile = sf_open(audioFilename, SFM_READ, &data.sliceD.sfinfoInput);
-    if (data.sliceD.infile == NULL) {
-        printf ("Error: could not open file: %s\n", audioFilename) ;
-        puts(sf_strerror (NULL)) ;
-        exit(1);
-    }
- 
-    hanning(data.window, WINDOW_SIZE);
-    memset(&data.sliceA.prev_left, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceA.prev_right, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceB.prev_left, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceB.prev_right, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceC.prev_left, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceC.prev_right, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceD.prev_left, 0, WINDOW_SIZE*sizeof(float));
-    memset(&data.sliceD.prev_right, 0, WINDOW_SIZE*sizeof(float));
-
+void initialize_audio() {
     PaStreamParameters outputParameters;
-    PaStreamParameters inputParameters;
     PaError err;
 
-    //Initilialize struct data
-    data.sliceSelector = 0;
-    // Set overlap factor
-    data.overlap = (WINDOW_SIZE - HOP_SIZE) / (float)WINDOW_SIZE;
-    data.overlap_samples = data.overlap * WINDOW_SIZE;
-    data.osamp = WINDOW_SIZE / HOP_SIZE;
-    //Slice initialization
-    data.sliceA.playing = false;
-    data.sliceA.start = INIT_START;
-    data.sliceA.loopCounter = 0;
-    data.sliceA.loopLength = DEFAULT_LOOP_LENGTH;
-    data.sliceA.volume = INIT_VOLUME;
-    data.sliceA.muter = 1.0;
-    data.sliceA.highpass = 0;
-    data.sliceA.lowpass = 0;
-
-    
-    data.sliceB.playing = false;
-    data.sliceB.start = data.sliceB.sfinfoInput.frames/4;//start at 1/4
-    data.sliceB.loopCounter = 0;
-    data.sliceB.loopLength = DEFAULT_LOOP_LENGTH;
-    data.sliceB.volume = INIT_VOLUME;
-    data.sliceB.muter = 1.0;
-    data.sliceB.highpass = 0;
-    data.sliceB.lowpass = 0;
-
-    data.sliceC.playing = false;
-    data.sliceC.start = data.sliceC.sfinfoInput.frames/2;//start 1/2
-    data.sliceC.loopCounter = 0;
-    data.sliceC.loopLength = DEFAULT_LOOP_LENGTH;
-    data.sliceC.volume = INIT_VOLUME;
-    data.sliceC.muter = 1.0;
-    data.sliceC.highpass = 0;
-    data.sliceC.lowpass = 0;
-    
-    data.sliceD.playing = false;
-    data.sliceD.start = 3 * (data.sliceD.sfinfoInput.frames/4);//start at 3/4 through file
-    data.sliceD.loopCounter = 0;
-    data.sliceD.loopLength = DEFAULT_LOOP_LENGTH;
-    data.sliceD.volume = INIT_VOLUME;
-    data.sliceD.muter = 1.0;
-    data.sliceD.highpass = 0;
-    data.sliceD.lowpass = 0;
-
-
-
     /* Initialize PortAudio */
     Pa_Initialize();
 
+    stats_init(&g_stats, (double)BUFFER_SIZE / SAMPLING_RATE);
+
     /* Set output stream parameters */
     outputParameters.device = Pa_GetDefaultOutputDevice();
     outputParameters.channelCount = g_channels;
@@ -682,7 +389,7 @@ void initialize_audio(char * audioFilename) {
             NULL,
             &outputParameters,
             SAMPLING_RATE, BUFFER_SIZE, paNoFlag, 
-            paCallback, &data);
+            paCallback, NULL);
 
 
     if (err != paNoError) {
@@ -723,11 +430,101 @@ void stop_portAudio(PaStream **stream) {
 //-----------------------------------------------------------------------------
 int main( int argc, char *argv[] )
 {
-    if (argc != 2) {
+    int numSlices = DEFAULT_SLICES;
+    char *audioFilename = NULL;
+    char *renderFilename = NULL;
+    char *slicesArg = NULL;
+    double seconds = DEFAULT_RENDER_SECONDS;
+    double budget = 0;
+    bool compact = false;
+    bool stft = false;
+    char *cacheDir = NULL;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            renderFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--stats") == 0) {
+            g_printStats = true;
+        }
+        else if (strcmp(argv[i], "--ahead") == 0) {
+            g_renderAhead = true;
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        }
+        else if (strcmp(argv[i], "--stft") == 0) {
+            stft = true;
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-cache") == 0) {
+            cacheDir = "";
+        }
+        else if (strcmp(argv[i], "--add") == 0 && i + 1 < argc) {
+            i++;//added once the engine is up
+        }
+        else if (audioFilename == NULL) {
+            audioFilename = argv[i];
+        }
+        else if (slicesArg == NULL) {
+            slicesArg = argv[i];
+        }
+        else {
+            audioFilename = NULL;
+            break;
+        }
+    }
+
+    if (audioFilename == NULL) {
         printf ("\nAn input file is required: \n");
-        printf ("    Usage : slicesampler <audio input filename> \n");
+        printf ("    Usage : slicesampler <audio input filename> [number of slices]\n");
+        printf ("            [--render <output filename> [--seconds N]] [--stats] [--ahead]\n");
+        printf ("            [--budget MB] [--compact] [--stft] [--cache DIR | --no-cache]\n");
+        printf ("            [--add <audio file>]...\n");
         exit (1);
     }
+    if (slicesArg != NULL) {
+        numSlices = atoi(slicesArg);
+        if (numSlices < 1 || numSlices > MAX_SLICES) {
+            printf ("Error: number of slices must be between 1 and %d\n", MAX_SLICES);
+            exit (1);
+        }
+    }
+    if (budget < 0) {
+        printf ("Error: --budget must be positive\n");
+        exit (1);
+    }
+    engine_memory_budget((size_t)(budget * 1048576));
+    engine_compact_samples(compact);
+    engine_stft_filter(stft);
+    engine_cache_dir(cacheDir);
+    if (renderFilename != NULL) {
+        if (seconds <= 0) {
+            printf ("Error: --seconds must be positive\n");
+            exit (1);
+        }
+        // Headless: no window, no audio device
+        if (engine_init(audioFilename, numSlices) != 0 || addFiles(argc, argv) != 0) {
+            exit (1);
+        }
+        stats_init(&g_stats, (double)BUFFER_SIZE / SAMPLING_RATE);
+        i = engine_render_file(renderFilename, seconds, &g_stats);
+        if (g_printStats) {
+            stats_print(&g_stats, stdout);
+        }
+        engine_free();
+        return i;
+    }
+
     // Print help
     help();
     
@@ -737,8 +534,17 @@ int main( int argc, char *argv[] )
     // Initialize Glut
     initialize_glut(argc, argv);
 
+    // Load the file and set up the slices
+    if (engine_init(audioFilename, numSlices) != 0 || addFiles(argc, argv) != 0) {
+        exit (1);
+    }
+    if (g_renderAhead && engine_render_ahead() != 0) {
+        engine_free();
+        exit (1);
+    }
+
     // Initialize PortAudio
-    initialize_audio(argv[1]);
+    initialize_audio();
 
     // Wait until 'q' is pressed to stop the process
     glutMainLoop();
@@ -774,78 +580,96 @@ void keyboardFunc( unsigned char key, int x, int y )
 
         //Start Stop
         case 32:
-            startstop();
+            sendCommand(CMD_STARTSTOP, 0);
             break;
 
         //Mute on/off
         case 'm': 
-            muteSlice();
+            sendCommand(CMD_MUTE, 0);
             break;
         //Select Slice A
         case 'a':
-            data.sliceSelector = 0;
+            selectSlice(0);
             break;
         //Select Slice B
         case 'b':
-            data.sliceSelector = 1;
+            selectSlice(1);
             break;
             
         //Select Slice C
         case 'c':
-            data.sliceSelector = 2;
+            selectSlice(2);
             break;
         //Select Slice D
         case 'd':
-            data.sliceSelector = 3;
+            selectSlice(3);
+            break;
+        //Select previous / next slice
+        case ',':
+            selectSlice(g_sliceSelector - 1);
+            break;
+        case '.':
+            selectSlice(g_sliceSelector + 1);
+            break;
+        //Previous / next file for the slice
+        case '<':
+            stepFile(-1);
+            break;
+        case '>':
+            stepFile(1);
+            break;
+        //Reload the slice's file from disk, it keeps playing meanwhile
+        case 'l':
+            reloadFile();
             break;
         //Increase Loop Length
         case ']':
-            increaseLoopLength();
+            sendCommand(CMD_LOOP_LONGER, 0);
             break;
         //Decrease Loop Length
         case '[':
-            decreaseLoopLength();
+            sendCommand(CMD_LOOP_SHORTER, 0);
 
             break;
         //Nudge right start location
         case '-':
-            nudgeLocation(-START_NUDGE_AMOUNT);
+            sendCommand(CMD_NUDGE, -START_NUDGE_AMOUNT);
             break;
         //Nudge left start location
         case '=':
-            nudgeLocation(START_NUDGE_AMOUNT);
+            sendCommand(CMD_NUDGE, START_NUDGE_AMOUNT);
             break;
 
         //Fast Nudge right start location
         case '_':
-            nudgeLocation(-FAST_NUDGE);
+            sendCommand(CMD_NUDGE, -FAST_NUDGE);
             break;
         //Fast Nudge left start location
         case '+':
-            nudgeLocation(FAST_NUDGE);
+            sendCommand(CMD_NUDGE, FAST_NUDGE);
             break;
 
         case 'e':
-            decreaseLowpass();
+            sendCommand(CMD_LOWPASS_DOWN, 0);
             break;
         case 'r':
-            increaseLowpass();
+            sendCommand(CMD_LOWPASS_UP, 0);
             break;
 
         case 'u':
-            decreaseHighpass();
+            sendCommand(CMD_HIGHPASS_DOWN, 0);
             break;
         case 'i':
-            increaseHighpass(); 
+            sendCommand(CMD_HIGHPASS_UP, 0);
             break;
         
         //Volume Increase
         case 't':
-            volumeIncrease();
+            sendCommand(CMD_VOLUME_UP, 0);
             break;
         //Volume Decrease
         case 'y':
-            volumeDecrease();
+            sendCommand(CMD_VOLUME_DOWN, 0);
             break;
 
         // Fullscreen
@@ -863,14 +687,17 @@ void keyboardFunc( unsigned char key, int x, int y )
             printf("[SLICESAMPLER]: fullscreen: %s\n", g_fullscreen ? "ON" : "OFF" );
             break;
 
+        case 'p':
+            print_stats();
+            break;
+
         case 'q':
             // Close Stream before exiting
             stop_portAudio(&g_stream);
-            free(songBuffer);
-            sf_close(data.sliceA.infile);
-            sf_close(data.sliceB.infile);
-            sf_close(data.sliceC.infile);
-            sf_close(data.sliceD.infile);
+            if (g_printStats) {
+                print_stats();
+            }
+            engine_free();
             printf("-------------------------------");
             printf("\nGOODBYE :)\n");
             exit( 0 );
@@ -1054,75 +881,52 @@ void rotateView () {
 // Desc: draws each waveform from their respective buffers
 //-----------------------------------------------------------------------------
 void drawWaveform() {
+    const sliceState *state = engine_state();
+    //one color per slice, cycled when there are more than four
+    static const GLfloat colors[4][3] = {
+        {1.0f, 0.0f, 0.0f},//Red
+        {1.0f, 0.20f, 0.0f},//Orange
+        {1.0f, 1.0f, 0.0f},//Yellow
+        {0.0f, 1.0f, 0.0f},//Green
+    };
+    GLfloat spacing = state->count > 1 ? 6.0f / (state->count - 1) : 0.0f;
+    int i;
 
     glPushMatrix();
     {
         //apply any rotations
         rotateView();
 
-        //Draw 1st slice waveform
-        glPushMatrix();
-        glTranslatef(0.0f, 3.0f,  0.0f);
-        if (data.sliceSelector == 0){
-            glColor3f(0.0f, 0.0f, 1.0f);
-        }
-        else {
-        glColor3f(1.0f, 0.0f, 0.0f);//Red
-        }
-        drawWindowedTimeDomain(data.sliceA.buffer);
-        glPopMatrix();
-
-        //Draw 2nd slice waveform
-        glPushMatrix();
-        glTranslatef(0.0f, 1.1f, 0.0f);
-        if (data.sliceSelector == 1){
-            glColor3f(0.0f, 0.0f, 1.0f);
-        }
-        else {
-            glColor3f(1.0f, 0.20f, 0.0f);//Orange
-        }
-        drawWindowedTimeDomain(data.sliceB.buffer);
-        glPopMatrix();
-        
-        //Draw 3rd slice waveform
-        glPushMatrix();
-        glTranslatef(0.0f, -1.1f, 0.0f);
-        if (data.sliceSelector == 2){
-            glColor3f(0.0f, 0.0f, 1.0f);
-        }
-        else {
-            glColor3f(1.0f, 1.0f, 0.0f);//Yellow
-        }
-        drawWindowedTimeDomain(data.sliceC.buffer);
-        glPopMatrix();
-
-        //Draw 4th slice waveform
-        glPushMatrix();
-        glTranslatef(0.0f, -3.0f, 0.0f);
-        if (data.sliceSelector == 3){
-            glColor3f(0.0f, 0.0f, 1.0f);
-        }
-        else {
-            glColor3f(0.0f, 1.0f, 0.0f);//Green
+        //Draw each slice waveform, top to bottom
+        for (i = 0; i < state->count; i++) {
+            glPushMatrix();
+            glTranslatef(0.0f, 3.0f - i * spacing, 0.0f);
+            //squash the waveforms once they would overlap
+            if (state->count > DEFAULT_SLICES) {
+                glScalef(1.0f, (GLfloat)DEFAULT_SLICES / state->count, 1.0f);
+            }
+            if (g_sliceSelector == i){
+                glColor3f(0.0f, 0.0f, 1.0f);
+            }
+            else {
+                glColor3fv(colors[i % 4]);
+            }
+            drawWindowedTimeDomain(state->wave[i]);
+            glPopMatrix();
         }
-        drawWindowedTimeDomain(data.sliceD.buffer);
-        glPopMatrix();
-
-
-       
     }
     glPopMatrix();
 }
 //-----------------------------------------------------------------------------
-// Name: void drawWindowedTimeDomain(SAMPLE *buffer)
+// Name: void drawWindowedTimeDomain(const SAMPLE *buffer)
 // Desc: Draws the Windowed Time Domain signal in the top of the screen
 //-----------------------------------------------------------------------------
-void drawWindowedTimeDomain(SAMPLE * buffer) {
+void drawWindowedTimeDomain(const SAMPLE * buffer) {
     // Initialize initial x
     GLfloat x = -5;
 
     // Calculate increment x
-    GLfloat xinc = fabs((2*x)/BUFFER_SIZE);
+    GLfloat xinc = fabs((2*x)/WAVE_POINTS);
 
     glPushMatrix();
     {
@@ -1130,7 +934,7 @@ void drawWindowedTimeDomain(SAMPLE * buffer) {
 
         //Draw Windowed Time Domain
         int i;
-        for (i = 0; i<BUFFER_SIZE; i++)
+        for (i = 0; i<WAVE_POINTS; i++)
         {
             glVertex3f(x, buffer[i], 0.0f);
             x += xinc;
@@ -1194,16 +998,11 @@ void drawPad() {
 //-----------------------------------------------------------------------------
 void displayFunc( )
 { 
-    SAMPLE buffer[g_buffer_size];
-
     // wait for data
-    while( !g_ready ) usleep( 1000 );
-
-    // copy currently playing audio into buffer
-    memcpy( buffer, data.sliceA.buffer, g_buffer_size * sizeof(SAMPLE) );
+    while( !atomic_load( &g_ready ) ) usleep( 1000 );
 
     // Hand off to audio callback thread
-    g_ready = false;
+    atomic_store( &g_ready, false );
 
     // clear the color and depth buffers
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
@@ -1219,460 +1018,71 @@ void displayFunc( )
 }
 
 //-----------------------------------------------------------------------------
-// Name: startstop
-// Desc: sets sf_seek to new location in audio file
+// Name: selectSlice
+// Desc: makes a slice the target of the edit keys
 //-----------------------------------------------------------------------------
-void startstop(){
-    switch (data.sliceSelector){
-        case 0:
-            if (data.sliceA.playing){
-                data.sliceA.playing = false;
-            }
-            else {
-                data.sliceA.playing = true;
-            }
-            break;
-        
-        case 1:
-            if (data.sliceB.playing){
-                data.sliceB.playing = false;
-            }
-            else {
-                data.sliceB.playing = true;
-            }
-            break;
-
-        case 2:
-            if (data.sliceC.playing){
-                data.sliceC.playing = false;
-            }
-            else {
-                data.sliceC.playing = true;
-            }
-            break;
-        
-        case 3:
-            if (data.sliceD.playing){
-                data.sliceD.playing = false;
-            }
-            else {
-                data.sliceD.playing = true;
-            }
-            break;   
-    }  
-}
-//-----------------------------------------------------------------------------
-// Name: increaseLoopLength
-// Desc: increases slice loop length
-//-----------------------------------------------------------------------------
-void increaseLoopLength(int length)
-{
-    switch (data.sliceSelector){
-        case 0:
-            if (data.sliceA.loopLength < INC_LOOP_LENGTH){
-                data.sliceA.loopLength = data.sliceA.loopLength * 2;
-            }
-            else if (data.sliceA.loopLength < data.sliceA.sfinfoInput.frames - INC_LOOP_LENGTH){//Only increase if loop length will be smaller than total audio
-                data.sliceA.loopLength += INC_LOOP_LENGTH;
-            }
-            break;
-        
-        case 1:
-            if (data.sliceB.loopLength < INC_LOOP_LENGTH){
-                data.sliceB.loopLength = data.sliceB.loopLength * 2;
-            }
-            else if (data.sliceB.loopLength < data.sliceB.sfinfoInput.frames - INC_LOOP_LENGTH){//Only increase if loop length will be smaller than total audio
-                data.sliceB.loopLength += INC_LOOP_LENGTH;
-            }
-            break;
-
-        case 2:
-            if (data.sliceC.loopLength < INC_LOOP_LENGTH){
-                data.sliceC.loopLength = data.sliceC.loopLength * 2;
-            }
-            else if (data.sliceC.loopLength < data.sliceC.sfinfoInput.frames - INC_LOOP_LENGTH){//Only increase if loop length will be smaller than total audio
-                data.sliceC.loopLength += INC_LOOP_LENGTH;
-            }
-            break;
-        
-        case 3:
-            if (data.sliceD.loopLength < INC_LOOP_LENGTH){
-                data.sliceD.loopLength = data.sliceD.loopLength * 2;
-            }
-            else if (data.sliceD.loopLength < data.sliceD.sfinfoInput.frames - INC_LOOP_LENGTH){//Only increase if loop length will be smaller than total audio
-                data.sliceD.loopLength += INC_LOOP_LENGTH;
-            }
-            break;   
-    }  
-    
-}//-----------------------------------------------------------------------------
-// Name: decreaseLoopLength
-// Desc: decreases slice loop length
-//-----------------------------------------------------------------------------
-void decreaseLoopLength()
-{
-    switch (data.sliceSelector){
-        case 0:
-            if (data.sliceA.loopLength - INC_LOOP_LENGTH > 0){//Only increase if loop length will be smaller than total audio
-                data.sliceA.loopLength -= INC_LOOP_LENGTH;
-            }
-            else {
-                if (data.sliceA.loopLength/2 > 0){
-                    data.sliceA.loopLength/=2;
-                }
-            }
-            break;
-        
-        case 1:
-            if (data.sliceB.loopLength - INC_LOOP_LENGTH > 0){
-                data.sliceB.loopLength -= INC_LOOP_LENGTH;
-            }
-            else {
-                if (data.sliceB.loopLength/2 > 0){
-                    data.sliceB.loopLength /= 2;
-                }
-            }
-            break;
-
-        case 2:
-            if (data.sliceC.loopLength - INC_LOOP_LENGTH > 0){
-                data.sliceC.loopLength -= INC_LOOP_LENGTH;
-            }
-            else {
-                if (data.sliceC.loopLength/2 > 0){
-                    data.sliceC.loopLength/=2;
-                }
-            }
-            break;
-        
-        case 3:
-            if (data.sliceD.loopLength - INC_LOOP_LENGTH > 0){
-                data.sliceD.loopLength -= INC_LOOP_LENGTH;
-            }
-            else {
-                if (data.sliceD.loopLength/2 > 0){
-                    data.sliceD.loopLength/=2;
-                }
-            }
-            break;   
-    }  
-    
-}
-//-----------------------------------------------------------------------------
-// Name: nudgeLocation
-// Desc: sets sf_seek to new location in audio file
-//-----------------------------------------------------------------------------
-void nudgeLocation(int nudgeAmount)
-{
-    switch (data.sliceSelector){
-        case 0:
-            if (data.sliceA.start + nudgeAmount > 0 && data.sliceA.start + nudgeAmount < data.sliceA.sfinfoInput.frames){
-                data.sliceA.start += nudgeAmount;
-            }
-            break;
-        
-        case 1:
-            if (data.sliceB.start + nudgeAmount > 0 && data.sliceB.start + nudgeAmount < data.sliceB.sfinfoInput.frames){
-                data.sliceB.start += nudgeAmount;
-            }
-            break;
-
-        case 2:
-            if (data.sliceC.start + nudgeAmount > 0 && data.sliceC.start + nudgeAmount < data.sliceC.sfinfoInput.frames){
-                data.sliceC.start += nudgeAmount;
-            }
-            break;
-        
-        case 3:
-            if (data.sliceD.start + nudgeAmount > 0 && data.sliceD.start + nudgeAmount < data.sliceD.sfinfoInput.frames){
-                data.sliceD.start += nudgeAmount;
-            }
-            break;    
+void selectSlice(int s){
+    if (s >= 0 && s < engine_state()->count){
+        g_sliceSelector = s;
+        printf("[SLICESAMPLER]: slice %d selected\n", s + 1);
     }
-   
-}
-//-----------------------------------------------------------------------------
-// Name: incrementLoops
-// Desc: increments loopcounters for all slices
-//-----------------------------------------------------------------------------
-void incrementLoops()
-{
-    data.sliceA.loopCounter++;
-    data.sliceB.loopCounter++;
-    data.sliceC.loopCounter++;
-    data.sliceD.loopCounter++;
-   
 }
 //-----------------------------------------------------------------------------
-// Name: resetLoops
-// Desc: resetLoops if they have reached their endpoint
+// Name: sendCommand
+// Desc: queues an edit of the selected slice for the audio thread (GUI)
 //-----------------------------------------------------------------------------
-void resetLoops()
-{
-    //reset at end of any loops
-    if (data.sliceA.loopCounter >= data.sliceA.loopLength){
-        sf_seek(data.sliceA.infile, data.sliceA.start, SEEK_SET);
-        data.sliceA.loopCounter = 0;
-    }
-    if (data.sliceB.loopCounter >= data.sliceB.loopLength){
-        sf_seek(data.sliceB.infile, data.sliceB.start, SEEK_SET);
-        data.sliceB.loopCounter = 0;
+void sendCommand(commandType type, int amount){
+    if (engine_send(type, g_sliceSelector, amount) != 0) {
+        printf("[SLICESAMPLER]: command queue full, key dropped\n");
     }
-    if (data.sliceC.loopCounter >= data.sliceC.loopLength){
-        sf_seek(data.sliceC.infile, data.sliceC.start, SEEK_SET);
-        data.sliceC.loopCounter = 0;
-    }
-    if (data.sliceD.loopCounter >= data.sliceD.loopLength){
-        sf_seek(data.sliceD.infile, data.sliceD.start, SEEK_SET);
-        data.sliceD.loopCounter = 0;
-    }
-   
 }
 //-----------------------------------------------------------------------------
-// Name: muteSlice
-// Desc: Mute on/off for slices
+// Name: stepFile
+// Desc: moves the selected slice to the previous / next file in the pool
 //-----------------------------------------------------------------------------
-void muteSlice()
-{
-    switch (data.sliceSelector){
-            case 0:
-                if (data.sliceA.volume != 0){
-                    data.sliceA.volume = 0;
-                }
-                else {
-                    data.sliceA.volume = INIT_VOLUME;
-                }
-                
-                break;
-    
-            case 1:
-                if (data.sliceB.volume != 0){
-                    data.sliceB.volume = 0;
-                }
-                else {
-                    data.sliceB.volume = INIT_VOLUME;
-                }
-                break;
-
-            case 2:
-                if (data.sliceC.volume != 0){
-                    data.sliceC.volume = 0;
-                }
-                else {
-                    data.sliceC.volume = INIT_VOLUME;
-                }
-                break;
-        
-            case 3:
-                if (data.sliceD.volume != 0){
-                    data.sliceD.volume = 0;
-                }
-                else {
-                    data.sliceD.volume = INIT_VOLUME;
-                }
-                break;   
-        } 
+void stepFile(int step){
+    int count = engine_file_count();
+    int file;
+
+    if (count < 2) {
+        printf("[SLICESAMPLER]: only one file, add more with --add\n");
+        return;
+    }
+    file = (engine_state()->file[g_sliceSelector] + step + count) % count;
+    sendCommand(CMD_FILE, file);
+    printf("[SLICESAMPLER]: slice %d plays %s\n", g_sliceSelector + 1, engine_file_name(file));
 }
 //-----------------------------------------------------------------------------
-// Name: volumeIncrease (outputBuffer)
-// Desc: increase the volume
+// Name: reloadFile
+// Desc: reads the selected slice's file again, e.g. after it was edited in
+//       another program; the old audio plays until the new is swapped in
 //-----------------------------------------------------------------------------
+void reloadFile(){
+    int file = engine_state()->file[g_sliceSelector];
 
-void volumeIncrease()
-
-{
-    switch (data.sliceSelector){
-            case 0:
-                if (data.sliceA.volume != 1){
-                    data.sliceA.volume += VOLUME_INCR;
-                }
-                break;
-
-            case 1:
-                if (data.sliceB.volume != 1){
-                
-                    data.sliceB.volume += VOLUME_INCR;
-                }
-                break;
-
-            case 2:
-                if (data.sliceC.volume != 1){
-                    data.sliceC.volume += VOLUME_INCR;
-                }
-                break;
-
-            case 3:
-                if (data.sliceD.volume != 1){
-                    data.sliceD.volume += VOLUME_INCR;
-                }
-                break;
-        }
+    if (engine_replace_file(file, engine_file_name(file)) == 0) {
+        printf("[SLICESAMPLER]: reloading %s\n", engine_file_name(file));
+    }
 }
-
 //-----------------------------------------------------------------------------
-// Name: volumeDecrease (outputBuffer)
-// Desc: decrease the volume
+// Name: addFiles
+// Desc: puts every --add file in the pool and deals the slices out across
+//       all the files in turn, returns 0 on success
 //-----------------------------------------------------------------------------
-
-void volumeDecrease()
-
-{
-    switch (data.sliceSelector){
-            case 0:
-                if (data.sliceA.volume != 0){
-                    data.sliceA.volume -= VOLUME_INCR;
-                }
-                break;
-
-            case 1:
-                if (data.sliceB.volume != 0){
-                    data.sliceB.volume -= VOLUME_INCR;
-                }
-                break;
-
-            case 2:
-                if (data.sliceC.volume != 0){
-                    data.sliceC.volume -= VOLUME_INCR;
-                }
-                break;
-
-            case 3:
-                if (data.sliceD.volume != 0){
-                    data.sliceD.volume -= VOLUME_INCR;
-                }
-                break;
-        }
-}
-
-void decreaseLowpass(){
-     switch (data.sliceSelector){
-            case 0:
-                data.sliceA.lowpass -= LOWPASS_INCR;
-                if (data.sliceA.lowpass < 0) {
-                    data.sliceA.lowpass = 0;
-                }
-                break;
-
-            case 1:
-                data.sliceB.lowpass -= LOWPASS_INCR;
-                if (data.sliceB.lowpass < 0) {
-                    data.sliceB.lowpass = 0;
-                }
-                break;
-
-            case 2:
-                data.sliceC.lowpass -= LOWPASS_INCR;
-                if (data.sliceC.lowpass < 0) {
-                    data.sliceC.lowpass = 0;
-                }
-                break;
-
-            case 3:
-                data.sliceD.lowpass -= LOWPASS_INCR;
-                if (data.sliceD.lowpass < 0) {
-                    data.sliceD.lowpass = 0;
-                }
-                break;
-        }
-
-}
-void increaseLowpass(){
-     switch (data.sliceSelector){
-            case 0:
-                data.sliceA.lowpass += LOWPASS_INCR;
-                if (data.sliceA.lowpass > WINDOW_SIZE/2) {
-                    data.sliceA.lowpass = WINDOW_SIZE/2;
-                }
-                break;
-
-            case 1:
-                data.sliceB.lowpass += LOWPASS_INCR;
-                if (data.sliceB.lowpass > WINDOW_SIZE/2) {
-                    data.sliceB.lowpass = WINDOW_SIZE/2;
-                }
-                break;
-
-            case 2:
-                data.sliceC.lowpass += LOWPASS_INCR;
-                if (data.sliceC.lowpass > WINDOW_SIZE/2) {
-                    data.sliceC.lowpass = WINDOW_SIZE/2;
-                }
-                break;
-
-            case 3:
-                data.sliceD.lowpass += LOWPASS_INCR;
-                if (data.sliceD.lowpass > WINDOW_SIZE/2) {
-                    data.sliceD.lowpass = WINDOW_SIZE/2;
-                }
-                break;
+int addFiles(int argc, char *argv[]){
+    int i, count;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--add") == 0 && i + 1 < argc) {
+            if (engine_add_file(argv[++i]) < 0) {
+                engine_free();
+                return -1;
+            }
         }
-
-}
-
-void decreaseHighpass()
-{
-    switch (data.sliceSelector){
-            case 0:
-                data.sliceA.highpass -= HIGHPASS_INCR;
-                if (data.sliceA.highpass < 0) {
-                    data.sliceA.highpass = 0;
-                }
-                break;
-
-            case 1:
-                data.sliceB.highpass -= HIGHPASS_INCR;
-                if (data.sliceB.highpass < 0) {
-                    data.sliceB.highpass = 0;
-                }
-                break;
-
-            case 2:
-                data.sliceC.highpass -= HIGHPASS_INCR;
-                if (data.sliceC.highpass < 0) {
-                    data.sliceC.highpass = 0;
-                }
-                break;
-
-            case 3:
-                data.sliceD.highpass -= HIGHPASS_INCR;
-                if (data.sliceD.highpass < 0) {
-                    data.sliceD.highpass = 0;
-                }
-                break;
-      }
-
-}
-
-void increaseHighpass()
-{
-    switch (data.sliceSelector){
-            case 0:
-                data.sliceA.highpass += HIGHPASS_INCR;
-                if (data.sliceA.highpass > WINDOW_SIZE/2) {
-                    data.sliceA.highpass = WINDOW_SIZE/2;
-                }
-                break;
-
-            case 1:
-                data.sliceB.highpass += HIGHPASS_INCR;
-                if (data.sliceB.highpass > WINDOW_SIZE/2) {
-                    data.sliceB.highpass = WINDOW_SIZE/2;
-                }
-                break;
-
-            case 2:
-                data.sliceC.highpass += HIGHPASS_INCR;
-                if (data.sliceC.highpass > WINDOW_SIZE/2) {
-                    data.sliceC.highpass = WINDOW_SIZE/2;
-                }
-                break;
-
-            case 3:
-                data.sliceD.highpass += HIGHPASS_INCR;
-                if (data.sliceD.highpass > WINDOW_SIZE/2) {
-                    data.sliceD.highpass = WINDOW_SIZE/2;
-                }
-                break;
     }
-
+    count = engine_file_count();
+    for (i = 0; i < engine_state()->count; i++) {
+        engine_send(CMD_FILE, i, i % count);
+    }
+    return 0;
 }
@@ -0,0 +1,174 @@
+//-----------------------------------------------------------------------------
+// name: stats.c
+// desc: audio callback timing and xrun accounting
+//-----------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200809L
+#include "stats.h"
+#include <time.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_bin()
+// desc: histogram bin for a duration, values below 16 ns get a bin each
+//-----------------------------------------------------------------------------
+static int stats_bin( unsigned long long ns )
+{
+    int msb, bin;
+
+    if( ns < (1u << (STATS_SUB_BITS + 1)) )
+        return (int)ns;
+
+    msb = 63 - __builtin_clzll( ns );
+    bin = ((msb - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+        + (int)((ns >> (msb - STATS_SUB_BITS)) & ((1u << STATS_SUB_BITS) - 1));
+
+    return bin < STATS_BINS ? bin : STATS_BINS - 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_bin_top()
+// desc: largest duration that lands in a bin
+//-----------------------------------------------------------------------------
+static unsigned long long stats_bin_top( int bin )
+{
+    int msb, sub;
+
+    if( bin < (1 << (STATS_SUB_BITS + 1)) )
+        return bin;
+
+    msb = (bin >> STATS_SUB_BITS) + STATS_SUB_BITS - 1;
+    sub = bin & ((1 << STATS_SUB_BITS) - 1);
+
+    return ((unsigned long long)((1 << STATS_SUB_BITS) + sub + 1) << (msb - STATS_SUB_BITS)) - 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_init()
+// desc: ...
+//-----------------------------------------------------------------------------
+void stats_init( callbackStats * stats, double period )
+{
+    int i;
+
+    stats->period = period;
+    atomic_init( &stats->callbacks, 0 );
+    atomic_init( &stats->underflows, 0 );
+    atomic_init( &stats->overflows, 0 );
+    atomic_init( &stats->maxNanos, 0 );
+    atomic_init( &stats->latencyNanos, 0 );
+    for( i = 0; i < STATS_BINS; i++ )
+        atomic_init( &stats->histogram[i], 0 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_now()
+// desc: ...
+//-----------------------------------------------------------------------------
+unsigned long long stats_now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_record()
+// desc: single writer, so plain load/store instead of read-modify-write;
+//       the callback count goes last so a reader never sees more
+//       callbacks than histogram entries
+//-----------------------------------------------------------------------------
+void stats_record( callbackStats * stats, unsigned long long start,
+                   int flags, double outputLatency )
+{
+    unsigned long long ns = stats_now() - start;
+    atomic_ullong * bin = &stats->histogram[stats_bin( ns )];
+
+    atomic_store_explicit( bin, atomic_load_explicit( bin, memory_order_relaxed ) + 1,
+                           memory_order_relaxed );
+    if( ns > atomic_load_explicit( &stats->maxNanos, memory_order_relaxed ) )
+        atomic_store_explicit( &stats->maxNanos, ns, memory_order_relaxed );
+    if( flags & STATS_UNDERFLOW )
+        atomic_store_explicit( &stats->underflows,
+            atomic_load_explicit( &stats->underflows, memory_order_relaxed ) + 1,
+            memory_order_relaxed );
+    if( flags & STATS_OVERFLOW )
+        atomic_store_explicit( &stats->overflows,
+            atomic_load_explicit( &stats->overflows, memory_order_relaxed ) + 1,
+            memory_order_relaxed );
+    if( outputLatency > 0 )
+        atomic_store_explicit( &stats->latencyNanos,
+            (unsigned long long)(outputLatency * 1e9), memory_order_relaxed );
+
+    atomic_store_explicit( &stats->callbacks,
+        atomic_load_explicit( &stats->callbacks, memory_order_relaxed ) + 1,
+        memory_order_release );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_percentile()
+// desc: upper edge of the bin holding the p-th callback
+//-----------------------------------------------------------------------------
+double stats_percentile( const callbackStats * stats, double p )
+{
+    unsigned long long total, rank, seen = 0;
+    int i;
+
+    total = atomic_load_explicit( &stats->callbacks, memory_order_acquire );
+    if( total == 0 || stats->period <= 0 )
+        return 0;
+
+    rank = (unsigned long long)(p * total);
+    if( rank < 1 )
+        rank = 1;
+
+    for( i = 0; i < STATS_BINS; i++ )
+    {
+        seen += atomic_load_explicit( &stats->histogram[i], memory_order_relaxed );
+        if( seen >= rank )
+            break;
+    }
+    if( i == STATS_BINS )
+        i = STATS_BINS - 1;
+
+    return stats_bin_top( i ) * 1e-9 / stats->period;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stats_print()
+// desc: ...
+//-----------------------------------------------------------------------------
+void stats_print( const callbackStats * stats, FILE * out )
+{
+    unsigned long long callbacks = atomic_load_explicit( &stats->callbacks, memory_order_acquire );
+    double max = stats->period > 0 ?
+        atomic_load_explicit( &stats->maxNanos, memory_order_relaxed ) * 1e-9 / stats->period : 0;
+
+    fprintf( out, "callbacks: %llu  underflows: %llu  overflows: %llu  output latency: %.1f ms\n",
+             callbacks,
+             atomic_load_explicit( &stats->underflows, memory_order_relaxed ),
+             atomic_load_explicit( &stats->overflows, memory_order_relaxed ),
+             atomic_load_explicit( &stats->latencyNanos, memory_order_relaxed ) * 1e-6 );
+    fprintf( out, "callback time / %.1f ms period: p50 %.4f  p99 %.4f  max %.4f\n",
+             stats->period * 1e3, stats_percentile( stats, 0.5 ),
+             stats_percentile( stats, 0.99 ), max );
+}
@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------
+// name: stats.h
+// desc: audio callback timing and xrun accounting
+//
+//   the audio thread is the only writer; any other thread may read the
+//   block at any time without locking.  callback times go into a
+//   log-linear histogram (8 steps per power of two nanoseconds, so any
+//   percentile is within 12.5% of the real value) and are reported as a
+//   fraction of the buffer period, 1.0 being a missed deadline.
+//-----------------------------------------------------------------------------
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+
+#define STATS_SUB_BITS          3
+#define STATS_BINS              320//covers up to ~2^41 ns
+#define STATS_UNDERFLOW         1//output underflow flag for stats_record()
+#define STATS_OVERFLOW          2//output overflow flag for stats_record()
+
+typedef struct {
+    double period;//seconds of audio per callback
+    atomic_ullong callbacks;
+    atomic_ullong underflows;
+    atomic_ullong overflows;
+    atomic_ullong maxNanos;
+    atomic_ullong latencyNanos;//last output latency reported by the device
+    atomic_ullong histogram[STATS_BINS];
+} callbackStats;
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// clear everything, period is frames per callback / sample rate
+void stats_init( callbackStats * stats, double period );
+// monotonic clock in nanoseconds
+unsigned long long stats_now( void );
+// audio thread: one callback that started at stats_now() == start
+void stats_record( callbackStats * stats, unsigned long long start,
+                   int flags, double outputLatency );
+// any thread: callback time at percentile p (0..1) as a fraction of period
+double stats_percentile( const callbackStats * stats, double p );
+// any thread: p50/p99/max, xruns and latency on one line each
+void stats_print( const callbackStats * stats, FILE * out );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif
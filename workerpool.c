@@ -0,0 +1,338 @@
+//-----------------------------------------------------------------------------
+// name: workerpool.c
+// desc: fork/join pool for the audio thread
+//
+//   a job is published as one 64-bit word, job number << 32 | item count
+//   << 16 | next item, so claiming an item is a single compare-and-swap
+//   and a thread that slept through a whole job can't claim from a stale
+//   one.  workers sleep on a semaphore between jobs; posting it never
+//   blocks the audio thread.
+//-----------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include "workerpool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+  #include <dispatch/dispatch.h>
+  #include <mach/mach.h>
+  #include <mach/thread_policy.h>
+#else
+  #include <semaphore.h>
+#endif
+
+#define POOL_ITEM_BITS          16
+#define POOL_ITEM_MASK          0xffffull
+
+
+struct workerPool {
+    int numThreads;
+    int minItems;
+    pthread_t threads[POOL_MAX_THREADS];
+#ifdef __APPLE__
+    dispatch_semaphore_t wake;
+#else
+    sem_t wake;
+#endif
+    atomic_bool quit;
+    atomic_ullong job;          // job << 32 | count << 16 | next
+    atomic_int done;            // items of the current job finished
+    unsigned long long jobs;    // jobs run, only touched by the caller
+    pool_func func;             // current job, fixed until it is done
+    void * user;
+};
+
+typedef struct {
+    workerPool * pool;
+    int core;
+} workerStart;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_pause()
+// desc: spin-wait hint
+//-----------------------------------------------------------------------------
+static inline void pool_pause( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    __builtin_ia32_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+    __asm__ __volatile__( "yield" );
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_post() / pool_wait()
+// desc: ...
+//-----------------------------------------------------------------------------
+static void pool_post( workerPool * pool )
+{
+#ifdef __APPLE__
+    dispatch_semaphore_signal( pool->wake );
+#else
+    sem_post( &pool->wake );
+#endif
+}
+
+static void pool_wait( workerPool * pool )
+{
+#ifdef __APPLE__
+    dispatch_semaphore_wait( pool->wake, DISPATCH_TIME_FOREVER );
+#else
+    while( sem_wait( &pool->wake ) != 0 )
+        ;
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_claim()
+// desc: next unclaimed item of the current job, -1 when there is none
+//-----------------------------------------------------------------------------
+static int pool_claim( workerPool * pool )
+{
+    unsigned long long job = atomic_load_explicit( &pool->job, memory_order_acquire );
+    unsigned long long count, next;
+
+    for( ;; )
+    {
+        count = (job >> POOL_ITEM_BITS) & POOL_ITEM_MASK;
+        next = job & POOL_ITEM_MASK;
+        if( next >= count )
+            return -1;
+        if( atomic_compare_exchange_weak_explicit( &pool->job, &job, job + 1,
+                                                   memory_order_acquire,
+                                                   memory_order_acquire ) )
+            return (int)next;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_work()
+// desc: run items until the job has none left
+//-----------------------------------------------------------------------------
+static void pool_work( workerPool * pool )
+{
+    int item;
+
+    while( (item = pool_claim( pool )) >= 0 )
+    {
+        pool->func( pool->user, item );
+        atomic_fetch_add_explicit( &pool->done, 1, memory_order_release );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_pin()
+// desc: pin the calling thread to a core and raise it to real-time
+//       priority; either can be refused, the pool works regardless
+//-----------------------------------------------------------------------------
+static void pool_pin( int core )
+{
+    struct sched_param param;
+
+#if defined( __linux__ )
+    cpu_set_t cpus;
+
+    CPU_ZERO( &cpus );
+    CPU_SET( core, &cpus );
+    pthread_setaffinity_np( pthread_self(), sizeof(cpus), &cpus );
+#elif defined( __APPLE__ )
+    // macos has no hard pinning, distinct tags keep the workers apart
+    thread_affinity_policy_data_t tag = { core + 1 };
+
+    thread_policy_set( pthread_mach_thread_np( pthread_self() ), THREAD_AFFINITY_POLICY,
+                       (thread_policy_t)&tag, THREAD_AFFINITY_POLICY_COUNT );
+#endif
+
+    param.sched_priority = (sched_get_priority_min( SCHED_FIFO )
+                         + sched_get_priority_max( SCHED_FIFO )) / 2;
+    pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_main()
+// desc: worker thread
+//-----------------------------------------------------------------------------
+static void * pool_main( void * arg )
+{
+    workerStart * start = (workerStart *)arg;
+    workerPool * pool = start->pool;
+
+    pool_pin( start->core );
+    free( start );
+
+    for( ;; )
+    {
+        pool_wait( pool );
+        if( atomic_load_explicit( &pool->quit, memory_order_acquire ) )
+            break;
+        pool_work( pool );
+    }
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_create()
+// desc: worker k goes on core k+1, the caller is left core 0
+//-----------------------------------------------------------------------------
+workerPool * pool_create( int threads, int minItems )
+{
+    workerPool * pool;
+    long cores = sysconf( _SC_NPROCESSORS_ONLN );
+    int i;
+
+    if( cores < 1 )
+        cores = 1;
+    if( threads == POOL_AUTO )
+        threads = (int)cores - 1;
+    if( threads < 0 )
+        threads = 0;
+    if( threads > POOL_MAX_THREADS )
+        threads = POOL_MAX_THREADS;
+
+    pool = (workerPool *)calloc( 1, sizeof(workerPool) );
+    if( pool == NULL )
+        return NULL;
+    pool->minItems = minItems;
+    atomic_init( &pool->quit, false );
+    atomic_init( &pool->job, 0 );
+    atomic_init( &pool->done, 0 );
+
+#ifdef __APPLE__
+    pool->wake = dispatch_semaphore_create( 0 );
+    if( pool->wake == NULL )
+    {
+        free( pool );
+        return NULL;
+    }
+#else
+    if( sem_init( &pool->wake, 0, 0 ) != 0 )
+    {
+        free( pool );
+        return NULL;
+    }
+#endif
+
+    for( i = 0; i < threads; i++ )
+    {
+        workerStart * start = (workerStart *)malloc( sizeof(workerStart) );
+
+        if( start == NULL )
+            break;
+        start->pool = pool;
+        start->core = (int)((i + 1) % cores);
+        if( pthread_create( &pool->threads[i], NULL, pool_main, start ) != 0 )
+        {
+            free( start );
+            break;
+        }
+        pool->numThreads++;
+    }
+
+    return pool;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_free()
+// desc: ...
+//-----------------------------------------------------------------------------
+void pool_free( workerPool * pool )
+{
+    int i;
+
+    if( pool == NULL )
+        return;
+
+    atomic_store_explicit( &pool->quit, true, memory_order_release );
+    for( i = 0; i < pool->numThreads; i++ )
+        pool_post( pool );
+    for( i = 0; i < pool->numThreads; i++ )
+        pthread_join( pool->threads[i], NULL );
+
+#ifdef __APPLE__
+    dispatch_release( pool->wake );
+#else
+    sem_destroy( &pool->wake );
+#endif
+    free( pool );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_threads()
+// desc: ...
+//-----------------------------------------------------------------------------
+int pool_threads( const workerPool * pool )
+{
+    return pool != NULL ? pool->numThreads : 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pool_run()
+// desc: fork: publish the job and wake as many workers as could help.
+//       join: work through the items too, then wait for the ones still
+//       running elsewhere
+//-----------------------------------------------------------------------------
+void pool_run( workerPool * pool, pool_func func, void * user, int count )
+{
+    int i, wake;
+
+    if( count <= 0 )
+        return;
+    if( pool == NULL || pool->numThreads == 0 || count < pool->minItems ||
+        count > POOL_MAX_ITEMS )
+    {
+        for( i = 0; i < count; i++ )
+            func( user, i );
+        return;
+    }
+
+    pool->func = func;
+    pool->user = user;
+    atomic_store_explicit( &pool->done, 0, memory_order_relaxed );
+    pool->jobs++;
+    atomic_store_explicit( &pool->job, (pool->jobs << 32) |
+                           ((unsigned long long)count << POOL_ITEM_BITS),
+                           memory_order_release );
+
+    wake = count - 1 < pool->numThreads ? count - 1 : pool->numThreads;
+    for( i = 0; i < wake; i++ )
+        pool_post( pool );
+
+    pool_work( pool );
+    while( atomic_load_explicit( &pool->done, memory_order_acquire ) < count )
+        pool_pause();
+}
@@ -0,0 +1,46 @@
+//-----------------------------------------------------------------------------
+// name: workerpool.h
+// desc: fork/join pool for the audio thread
+//
+//   the threads are started once, pinned one to a core and given real-time
+//   priority where the system allows it.  pool_run() hands out the items of
+//   a job one at a time through a single atomic counter; the calling thread
+//   takes items as well, so it never waits on a worker that is still
+//   asleep, only on items a worker is already running.  nothing in
+//   pool_run() takes a lock.
+//-----------------------------------------------------------------------------
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+
+#define POOL_AUTO               -1//one thread per core besides the caller
+#define POOL_MAX_THREADS        63
+#define POOL_MAX_ITEMS          65535//items per job
+
+typedef struct workerPool workerPool;
+
+// one item of a job, called on some thread of the pool
+typedef void (* pool_func)( void * user, int item );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  extern "C" {
+#endif
+
+// start threads workers (POOL_AUTO for the core count); jobs of fewer than
+// minItems items are run on the caller.  NULL on failure
+workerPool * pool_create( int threads, int minItems );
+// stop and join the workers, pool may be NULL
+void pool_free( workerPool * pool );
+// number of worker threads, not counting the caller
+int pool_threads( const workerPool * pool );
+// run func for every item in [0, count) and return when all are done;
+// a NULL pool runs everything on the caller.  one caller at a time
+void pool_run( workerPool * pool, pool_func func, void * user, int count );
+
+// c linkage
+#if ( defined( __cplusplus ) || defined( _cplusplus ) )
+  }
+#endif
+
+#endif